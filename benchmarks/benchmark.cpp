@@ -0,0 +1,324 @@
+/*
+ * benchmark.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "city_generator.h"
+
+#include "json_lib.h"
+#include "parser.h"
+#include "queries.h"
+#include "thread_pool.h"
+#include "transport_register.h"
+#include "transport_router.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// usage: transport_benchmark [--stops N] [--buses N] [--route-length N]
+//     [--roundtrip-ratio R] [--queries N] [--query-mix BUS:STOP:ROUTE]
+//     [--router NAME] [--threads N] [--repeat N] [--seed N] [--prerender]
+//     [--emit]
+//   the synthetic network is generated from the options and the load, build and
+//   query phases are timed on it; the report is written to stdout as json.
+//   --prerender: the Stop and Bus responses are rendered ahead of the queries
+//   --emit: the generated input is written to stdout instead, nothing is timed
+namespace {
+struct Options {
+	CityGenerator::Params city;
+	size_t thread_count = 1;
+	size_t repeat_count = 5;
+	bool prerender = false;
+	bool emit = false;
+};
+
+// the weights of the query mix, e.g. "1:1:2"
+void ParseQueryMix(string_view text, CityGenerator::Params& params) {
+	vector<double> weights;
+	while (true) {
+		const size_t colon = text.find(':');
+		weights.push_back(stod(string(text.substr(0, colon))));
+		if (colon == string_view::npos) {
+			break;
+		}
+		text.remove_prefix(colon + 1);
+	}
+	if (weights.size() != 3
+			|| any_of(begin(weights), end(weights), [](double weight) {
+				return weight < 0.0;
+			})) {
+		throw invalid_argument("--query-mix takes three weights, BUS:STOP:ROUTE");
+	}
+	params.bus_query_weight = weights[0];
+	params.stop_query_weight = weights[1];
+	params.route_query_weight = weights[2];
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+	Options options;
+	auto& city = options.city;
+	for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+		const string_view name = argv[arg_idx];
+		if (name == "--emit") {
+			options.emit = true;
+			continue;
+		} else if (name == "--prerender") {
+			options.prerender = true;
+			continue;
+		}
+		if (arg_idx + 1 == argc) {
+			throw invalid_argument("no value for " + string(name));
+		}
+		const string value = argv[++arg_idx];
+		if (name == "--stops") {
+			city.stop_count = stoull(value);
+		} else if (name == "--buses") {
+			city.bus_count = stoull(value);
+		} else if (name == "--route-length") {
+			city.route_length = stoull(value);
+		} else if (name == "--roundtrip-ratio") {
+			city.roundtrip_ratio = stod(value);
+		} else if (name == "--queries") {
+			city.query_count = stoull(value);
+		} else if (name == "--query-mix") {
+			ParseQueryMix(value, city);
+		} else if (name == "--router") {
+			city.router = value;
+		} else if (name == "--threads") {
+			options.thread_count = stoull(value);
+		} else if (name == "--repeat") {
+			options.repeat_count = max<size_t>(stoull(value), 1);
+		} else if (name == "--seed") {
+			city.seed = stoull(value);
+		} else {
+			throw invalid_argument("unknown option " + string(name));
+		}
+	}
+	return options;
+}
+
+// the responses are rendered in full but not written anywhere
+class NullBuffer : public streambuf {
+protected:
+	int overflow(int ch) override {
+		return ch;
+	}
+
+	streamsize xsputn(const char*, streamsize count) override {
+		return count;
+	}
+};
+
+// durations of the runs of one phase; throughput is in units per second,
+// a run handling units_per_run units
+struct Phase {
+	string name;
+	string unit;
+	double units_per_run = 1.0;
+	vector<double> seconds;
+};
+
+template<typename Func>
+double MeasureSeconds(Func func) {
+	const auto start = chrono::steady_clock::now();
+	func();
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// nearest rank; the durations must be sorted
+double GetPercentile(const vector<double>& sorted_seconds, double share) {
+	const size_t rank = static_cast<size_t>(ceil(share * sorted_seconds.size()));
+	return sorted_seconds[max<size_t>(rank, 1) - 1];
+}
+
+void WritePhase(Phase phase, Json::Writer& writer) {
+	sort(begin(phase.seconds), end(phase.seconds));
+	const double total_seconds = accumulate(begin(phase.seconds),
+			end(phase.seconds), 0.0);
+	const double mean_seconds = total_seconds / phase.seconds.size();
+	writer.BeginDict();
+	writer.Key("name").String(phase.name);
+	writer.Key("runs").Int(static_cast<int>(phase.seconds.size()));
+	writer.Key("unit").String(phase.unit);
+	writer.Key("units_per_run").Double(phase.units_per_run);
+	writer.Key("mean_ms").Double(mean_seconds * 1e3);
+	writer.Key("p50_ms").Double(GetPercentile(phase.seconds, 0.5) * 1e3);
+	writer.Key("p90_ms").Double(GetPercentile(phase.seconds, 0.9) * 1e3);
+	writer.Key("p99_ms").Double(GetPercentile(phase.seconds, 0.99) * 1e3);
+	writer.Key("max_ms").Double(phase.seconds.back() * 1e3);
+	writer.Key("throughput").Double(
+			phase.units_per_run * phase.seconds.size() / total_seconds);
+	writer.EndDict();
+}
+
+void WriteReport(const Options& options, size_t input_size,
+		const vector<Phase>& phases, ostream& output) {
+	const auto& city = options.city;
+	Json::Writer writer(output);
+	writer.BeginDict();
+	writer.Key("params").BeginDict();
+	writer.Key("stops").Int(static_cast<int>(city.stop_count));
+	writer.Key("buses").Int(static_cast<int>(city.bus_count));
+	writer.Key("route_length").Int(static_cast<int>(city.route_length));
+	writer.Key("roundtrip_ratio").Double(city.roundtrip_ratio);
+	writer.Key("queries").Int(static_cast<int>(city.query_count));
+	writer.Key("query_mix").BeginArray().Double(city.bus_query_weight).Double(
+			city.stop_query_weight).Double(city.route_query_weight).EndArray();
+	writer.Key("router").String(city.router);
+	writer.Key("threads").Int(static_cast<int>(options.thread_count));
+	writer.Key("repeat").Int(static_cast<int>(options.repeat_count));
+	writer.Key("seed").Int(static_cast<int>(city.seed));
+	writer.Key("prerender").Bool(options.prerender);
+	writer.EndDict();
+	writer.Key("input_bytes").Int(static_cast<int>(input_size));
+	writer.Key("phases").BeginArray();
+	for (const Phase& phase : phases) {
+		WritePhase(phase, writer);
+	}
+	writer.EndArray();
+	rusage usage { };
+	getrusage(RUSAGE_SELF, &usage);
+	writer.Key("peak_rss_kb").Int(static_cast<int>(usage.ru_maxrss));
+	writer.EndDict();
+	writer.Flush(true);
+	output << endl;
+}
+
+vector<Phase> RunPhases(const Options& options, const string& input) {
+	const size_t repeat_count = options.repeat_count;
+	ThreadPool thread_pool(options.thread_count);
+	vector<Phase> phases;
+
+	Phase load { "json_load", "bytes", static_cast<double>(input.size()), { } };
+	for (size_t run = 0; run < repeat_count; ++run) {
+		string text = input;
+		load.seconds.push_back(MeasureSeconds([&text] {
+			Json::Load(move(text), Json::MemoryMode::Arena);
+		}));
+	}
+	phases.push_back(move(load));
+	const auto input_doc = Json::Load(input, Json::MemoryMode::Arena);
+	const auto& input_map = input_doc.GetRoot().AsMap();
+	const auto& base_requests = input_map.at("base_requests").AsArray();
+	const auto& routing_settings = input_map.at("routing_settings").AsMap();
+	const auto& stat_requests = input_map.at("stat_requests").AsArray();
+
+	Phase read { "read_base_requests", "requests",
+		static_cast<double>(base_requests.size()), { } };
+	for (size_t run = 0; run < repeat_count; ++run) {
+		read.seconds.push_back(MeasureSeconds([&base_requests] {
+			BusOrStopInfo::ReadBusOrStopInfo(base_requests);
+		}));
+	}
+	phases.push_back(move(read));
+
+	// the router alone, which the register builds after its bus stats
+	const auto data = BusOrStopInfo::ReadBusOrStopInfo(base_requests);
+	Phase router { "router_build", "stops",
+		static_cast<double>(data.stops.size()), { } };
+	for (size_t run = 0; run < repeat_count; ++run) {
+		router.seconds.push_back(MeasureSeconds([&] {
+			TransportRouter(data.stops, data.buses, routing_settings, thread_pool);
+		}));
+	}
+	phases.push_back(move(router));
+
+	Phase build { "register_build", "stops",
+		static_cast<double>(data.stops.size()), { } };
+	optional<TransportRegister> db;
+	for (size_t run = 0; run < repeat_count; ++run) {
+		auto run_data = BusOrStopInfo::ReadBusOrStopInfo(base_requests);
+		db.reset();
+		build.seconds.push_back(MeasureSeconds([&] {
+			db.emplace(move(run_data), routing_settings, thread_pool);
+		}));
+	}
+	phases.push_back(move(build));
+
+	if (options.prerender) {
+		Phase render { "response_render", "responses",
+			static_cast<double>(db->GetStopCount() + db->GetBusCount()), { } };
+		for (size_t run = 0; run < repeat_count; ++run) {
+			render.seconds.push_back(MeasureSeconds([&] {
+				Queries::RenderResponses(*db, thread_pool);
+			}));
+		}
+		phases.push_back(move(render));
+	}
+
+	// every run starts with an empty route cache
+	NullBuffer null_buffer;
+	ostream null_output(&null_buffer);
+	Phase process_all { "process_all", "requests",
+		static_cast<double>(stat_requests.size()), { } };
+	for (size_t run = 0; run < repeat_count; ++run) {
+		db->SetRouteCacheCapacity(TransportRegister::DEFAULT_ROUTE_CACHE_CAPACITY);
+		process_all.seconds.push_back(MeasureSeconds([&] {
+			Queries::ProcessAll(*db, stat_requests, thread_pool, null_output);
+		}));
+	}
+	phases.push_back(move(process_all));
+
+	// latencies of single requests by type, answered one by one by this thread
+	db->SetRouteCacheCapacity(TransportRegister::DEFAULT_ROUTE_CACHE_CAPACITY);
+	map<string, Phase> query_phases;
+	Json::Writer writer;
+	for (const Json::Node& request_node : stat_requests) {
+		const auto& attrs = request_node.AsMap();
+		const string type(attrs.at("type").AsString());
+		auto [it, inserted] = query_phases.try_emplace(type);
+		if (inserted) {
+			it->second = Phase { "query_" + type, "requests", 1.0, { } };
+		}
+		const int request_id = attrs.at("id").AsInt();
+		it->second.seconds.push_back(MeasureSeconds([&] {
+			visit([&db, request_id, &writer](const auto& request) {
+				request.Process(*db, request_id, writer);
+			}, Queries::Read(attrs));
+		}));
+		writer.Clear();
+	}
+	for (auto& [type, phase] : query_phases) {
+		phases.push_back(move(phase));
+	}
+	return phases;
+}
+}
+
+int main(int argc, char* argv[]) {
+	Options options;
+	ostringstream input_stream;
+	try {
+		options = ParseOptions(argc, argv);
+		CityGenerator::WriteInput(options.city, input_stream);
+	} catch (const exception& error) {
+		cerr << error.what() << endl;
+		return 1;
+	}
+
+	if (options.emit) {
+		cout << input_stream.str() << endl;
+		return 0;
+	}
+	const string input = input_stream.str();
+	WriteReport(options, input.size(), RunPhases(options, input), cout);
+
+	return 0;
+}
@@ -0,0 +1,289 @@
+/*
+ * city_generator.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "city_generator.h"
+
+#include "distance_utils.h"
+#include "json_lib.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace CityGenerator {
+namespace {
+constexpr double CENTER_LATITUDE = 55.75;
+constexpr double CENTER_LONGITUDE = 37.62;
+constexpr double GRID_STEP_METERS = 300.0;
+constexpr double METERS_PER_LATITUDE_DEGREE = 111'195.0;
+constexpr double JITTER = 0.3;  // of a grid step
+constexpr double MAX_ROAD_STRETCH = 0.3;  // of the geo distance
+
+// the distributions of the standard library may differ between implementations,
+// only the engine is fully specified; so the numbers are derived from its output here
+class Random {
+public:
+	explicit Random(uint64_t seed) :
+			engine_(seed) {
+	}
+
+	// in [0, 1)
+	double Uniform() {
+		return (engine_() >> 11) * 0x1.0p-53;
+	}
+
+	// in [0, bound)
+	size_t Below(size_t bound) {
+		return engine_() % bound;
+	}
+
+private:
+	mt19937_64 engine_;
+};
+
+class City {
+public:
+	City(const Params& params, Random& random) :
+			stop_count_(params.stop_count), side_(
+					static_cast<size_t>(ceil(sqrt(static_cast<double>(stop_count_))))), distances_(
+					stop_count_) {
+		const double latitude_step = GRID_STEP_METERS / METERS_PER_LATITUDE_DEGREE;
+		const double longitude_step = latitude_step
+				/ cos(Earth::ConvertDegreesToRadians(CENTER_LATITUDE));
+		positions_.reserve(stop_count_);
+		for (size_t stop_idx = 0; stop_idx < stop_count_; ++stop_idx) {
+			const double row = stop_idx / side_ + JITTER * (2.0 * random.Uniform() - 1.0);
+			const double column = stop_idx % side_
+					+ JITTER * (2.0 * random.Uniform() - 1.0);
+			positions_.push_back(Earth::Point {
+					CENTER_LATITUDE + (row - side_ / 2.0) * latitude_step,
+					CENTER_LONGITUDE + (column - side_ / 2.0) * longitude_step });
+		}
+	}
+
+	size_t GetStopCount() const {
+		return stop_count_;
+	}
+
+	Earth::Point GetPosition(size_t stop_idx) const {
+		return positions_[stop_idx];
+	}
+
+	// the stops which the road distances are set to, by their indices
+	const map<size_t, int>& GetDistances(size_t stop_idx) const {
+		return distances_[stop_idx];
+	}
+
+	// a walk of stop_count stops between neighbouring cells, going back to
+	// the previous stop only from a dead end
+	vector<size_t> MakeWalk(size_t stop_count, Random& random) const {
+		vector<size_t> walk { random.Below(stop_count_) };
+		while (walk.size() < stop_count) {
+			const size_t current = walk.back();
+			const size_t previous =
+					walk.size() > 1 ? walk[walk.size() - 2] : stop_count_;
+			vector<size_t> candidates;
+			for (const size_t neighbour : GetNeighbours(current)) {
+				if (neighbour != previous) {
+					candidates.push_back(neighbour);
+				}
+			}
+			walk.push_back(
+					candidates.empty() ?
+							previous : candidates[random.Below(candidates.size())]);
+		}
+		return walk;
+	}
+
+	// the distance is set in one direction only, the register uses it the other way round too
+	void AddRoadDistance(size_t from, size_t to, Random& random) {
+		if (distances_[from].count(to) > 0 || distances_[to].count(from) > 0) {
+			return;
+		}
+		const double geo_distance = Earth::Distance(positions_[from],
+				positions_[to]);
+		distances_[from][to] = max(1,
+				static_cast<int>(lround(
+						geo_distance * (1.0 + MAX_ROAD_STRETCH * random.Uniform()))));
+	}
+
+private:
+	vector<size_t> GetNeighbours(size_t stop_idx) const {
+		vector<size_t> neighbours;
+		const size_t row = stop_idx / side_;
+		const size_t column = stop_idx % side_;
+		if (row > 0) {
+			neighbours.push_back(stop_idx - side_);
+		}
+		if (column > 0) {
+			neighbours.push_back(stop_idx - 1);
+		}
+		if (column + 1 < side_ && stop_idx + 1 < stop_count_) {
+			neighbours.push_back(stop_idx + 1);
+		}
+		if (stop_idx + side_ < stop_count_) {
+			neighbours.push_back(stop_idx + side_);
+		}
+		return neighbours;
+	}
+
+	const size_t stop_count_;
+	const size_t side_;
+	vector<Earth::Point> positions_;
+	vector<map<size_t, int>> distances_;
+};
+
+struct BusRoute {
+	vector<size_t> stops;
+	bool is_roundtrip;
+};
+
+BusRoute MakeBusRoute(const Params& params, City& city, Random& random) {
+	BusRoute route;
+	route.is_roundtrip = random.Uniform() < params.roundtrip_ratio;
+	if (route.is_roundtrip) {
+		// the walk is closed by going back to its first stop
+		route.stops = city.MakeWalk(max<size_t>(params.route_length - 1, 2),
+				random);
+		if (route.stops.back() != route.stops.front()) {
+			route.stops.push_back(route.stops.front());
+		}
+	} else {
+		route.stops = city.MakeWalk(params.route_length, random);
+	}
+	for (size_t idx = 1; idx < route.stops.size(); ++idx) {
+		city.AddRoadDistance(route.stops[idx - 1], route.stops[idx], random);
+	}
+	return route;
+}
+
+string MakeStopName(size_t stop_idx) {
+	return "Stop " + to_string(stop_idx);
+}
+
+string MakeBusName(size_t bus_idx) {
+	return "Bus " + to_string(bus_idx);
+}
+
+void WriteStop(const City& city, size_t stop_idx, Json::Writer& writer) {
+	const auto position = city.GetPosition(stop_idx);
+	writer.BeginDict();
+	writer.Key("type").String("Stop");
+	writer.Key("name").String(MakeStopName(stop_idx));
+	writer.Key("latitude").Double(position.latitude);
+	writer.Key("longitude").Double(position.longitude);
+	writer.Key("road_distances").BeginDict();
+	for (const auto& [to_idx, distance] : city.GetDistances(stop_idx)) {
+		writer.Key(MakeStopName(to_idx)).Int(distance);
+	}
+	writer.EndDict();
+	writer.EndDict();
+}
+
+void WriteBus(const BusRoute& route, size_t bus_idx, Json::Writer& writer) {
+	writer.BeginDict();
+	writer.Key("type").String("Bus");
+	writer.Key("name").String(MakeBusName(bus_idx));
+	writer.Key("stops").BeginArray();
+	for (const size_t stop_idx : route.stops) {
+		writer.String(MakeStopName(stop_idx));
+	}
+	writer.EndArray();
+	writer.Key("is_roundtrip").Bool(route.is_roundtrip);
+	writer.EndDict();
+}
+
+// the routes are asked for between stops served by the buses, as there are none
+// between the others
+void WriteQuery(const Params& params, const vector<size_t>& served_stops,
+		int request_id, Random& random, Json::Writer& writer) {
+	const double total_weight = params.bus_query_weight
+			+ params.stop_query_weight + params.route_query_weight;
+	const double choice = random.Uniform() * total_weight;
+	writer.BeginDict();
+	if (choice < params.bus_query_weight) {
+		writer.Key("type").String("Bus");
+		writer.Key("name").String(MakeBusName(random.Below(params.bus_count)));
+	} else if (choice < params.bus_query_weight + params.stop_query_weight) {
+		writer.Key("type").String("Stop");
+		writer.Key("name").String(MakeStopName(random.Below(params.stop_count)));
+	} else {
+		writer.Key("type").String("Route");
+		writer.Key("from").String(
+				MakeStopName(served_stops[random.Below(served_stops.size())]));
+		writer.Key("to").String(
+				MakeStopName(served_stops[random.Below(served_stops.size())]));
+	}
+	writer.Key("id").Int(request_id);
+	writer.EndDict();
+}
+}
+
+void WriteInput(const Params& params, ostream& output) {
+	if (params.stop_count < 2 || params.bus_count == 0
+			|| params.route_length < 2) {
+		throw invalid_argument(
+				"a city needs at least 2 stops, 1 bus and 2 stops per route");
+	}
+	if (params.query_count > 0
+			&& params.bus_query_weight + params.stop_query_weight
+					+ params.route_query_weight <= 0.0) {
+		throw invalid_argument("the query weights must not all be zero");
+	}
+
+	Random random(params.seed);
+	City city(params, random);
+	// the routes are made first, the road distances of the stops come from them
+	vector<BusRoute> routes;
+	routes.reserve(params.bus_count);
+	for (size_t bus_idx = 0; bus_idx < params.bus_count; ++bus_idx) {
+		routes.push_back(MakeBusRoute(params, city, random));
+	}
+	vector<size_t> served_stops;
+	for (const auto& route : routes) {
+		served_stops.insert(end(served_stops), begin(route.stops),
+				end(route.stops));
+	}
+	sort(begin(served_stops), end(served_stops));
+	served_stops.erase(unique(begin(served_stops), end(served_stops)),
+			end(served_stops));
+
+	Json::Writer writer(output);
+	writer.BeginDict();
+	writer.Key("routing_settings").BeginDict();
+	writer.Key("bus_wait_time").Int(6);
+	writer.Key("bus_speed").Int(40);
+	writer.Key("router").String(params.router);
+	writer.EndDict();
+
+	writer.Key("base_requests").BeginArray();
+	for (size_t stop_idx = 0; stop_idx < city.GetStopCount(); ++stop_idx) {
+		WriteStop(city, stop_idx, writer);
+		writer.Flush();
+	}
+	for (size_t bus_idx = 0; bus_idx < routes.size(); ++bus_idx) {
+		WriteBus(routes[bus_idx], bus_idx, writer);
+		writer.Flush();
+	}
+	writer.EndArray();
+
+	writer.Key("stat_requests").BeginArray();
+	for (size_t query_idx = 0; query_idx < params.query_count; ++query_idx) {
+		WriteQuery(params, served_stops, static_cast<int>(query_idx + 1), random,
+				writer);
+		writer.Flush();
+	}
+	writer.EndArray();
+	writer.EndDict();
+	writer.Flush(true);
+}
+}
@@ -0,0 +1,41 @@
+/*
+ * city_generator.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef CITY_GENERATOR_H_
+#define CITY_GENERATOR_H_
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// synthetic networks for benchmarking, written in the input format of the register
+namespace CityGenerator {
+struct Params {
+	size_t stop_count = 2000;
+	size_t bus_count = 200;
+	size_t route_length = 20;  // stops listed per bus, the closing one of a roundtrip included
+	double roundtrip_ratio = 0.5;  // share of the buses which are roundtrips
+	size_t query_count = 10000;
+	// relative weights of the Bus, Stop and Route stat requests
+	double bus_query_weight = 1.0;
+	double stop_query_weight = 1.0;
+	double route_query_weight = 2.0;
+	std::string router = "all_pairs";
+	uint64_t seed = 1;
+};
+
+// the same params and seed always give the same input, byte for byte.
+// The stops are laid out on a jittered square grid, about 300 m apart, and
+// every bus walks between neighbouring cells of the grid, so the network
+// is connected wherever the buses reach; the road distances are the geo
+// ones stretched by up to 30%
+void WriteInput(const Params& params, std::ostream& output);
+}
+
+#endif /* CITY_GENERATOR_H_ */
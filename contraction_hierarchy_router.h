@@ -0,0 +1,636 @@
+/*
+ * contraction_hierarchy_router.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef CONTRACTION_HIERARCHY_ROUTER_H_
+#define CONTRACTION_HIERARCHY_ROUTER_H_
+
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "router_base.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Graph {
+
+// contraction hierarchies: the vertices are contracted one by one in the order of
+// their importance, and the shortest paths running through a contracted vertex are
+// preserved by shortcut arcs; a query is a bidirectional search which only goes
+// "upwards" in that order, and the shortcuts are unpacked back into the original edges
+template<typename Weight>
+class ContractionHierarchyRouter: public RouterBase<Weight> {
+private:
+	using Graph = CsrGraph<Weight>;
+	using typename RouterBase<Weight>::ExpandedRoute;
+	using typename RouterBase<Weight>::GraphChange;
+
+public:
+	explicit ContractionHierarchyRouter(const Graph& graph);
+	ContractionHierarchyRouter(const Graph& graph, Snapshot::Reader& reader);
+
+	void Serialize(Snapshot::Writer& writer) const override;
+
+	size_t GetMemoryUsage() const override;
+
+	std::vector<Weight> ComputeWeightMatrix(const std::vector<VertexId>& sources,
+			const std::vector<VertexId>& targets) const override;
+
+protected:
+	std::optional<ExpandedRoute> ExpandRoute(VertexId from, VertexId to) const
+			override;
+	// the order of contraction depends on the whole graph, so the hierarchy is rebuilt
+	void UpdateRoutes(const GraphChange& change) override;
+
+private:
+	static_assert(std::numeric_limits<Weight>::has_infinity,
+			"a missing route is encoded with an infinite weight");
+	static constexpr Weight NO_ROUTE = std::numeric_limits<Weight>::infinity();
+	static constexpr uint32_t NO_ARC = std::numeric_limits<uint32_t>::max();
+
+	// upper bounds of vertices settled by a witness search when estimating the importance
+	// and when contracting; when one is hit the shortcut is considered necessary,
+	// which costs memory but not correctness
+	static constexpr size_t SIMULATION_SETTLE_LIMIT = 50;
+	static constexpr size_t CONTRACTION_SETTLE_LIMIT = 500;
+
+	// the arcs of the hierarchy: the original edges (arc id == edge id)
+	// followed by the shortcuts, each replacing the path of its two child arcs;
+	// a removed edge leaves a self-loop placeholder which is never searched
+	struct Arc {
+		VertexId from;
+		VertexId to;
+		Weight weight;
+		uint32_t first_child;  // NO_ARC for original edges
+		uint32_t second_child;
+	};
+
+	// mutable state of the preprocessing
+	struct ContractionState {
+		std::vector<std::vector<uint32_t>> in_arcs;
+		std::vector<std::vector<uint32_t>> out_arcs;
+		std::vector<bool> is_contracted;
+		std::vector<size_t> deleted_neighbour_counts;
+
+		// witness search labels, reset lazily with a search counter
+		std::vector<Weight> witness_weights;
+		std::vector<size_t> witness_search_ids;
+		std::vector<size_t> witness_target_search_ids;
+		size_t witness_search_id = 0;
+	};
+
+	using NeighbourArcs = std::vector<std::pair<VertexId, uint32_t>>;
+
+	// labels of a query, reset through the list of touched vertices
+	struct SearchSpace {
+		std::vector<Weight> weights[2];  // forward and backward
+		std::vector<uint32_t> parent_arcs[2];
+		std::vector<VertexId> touched_vertices;
+
+		void Prepare(size_t vertex_count);
+		void Reset();
+	};
+
+	void Contract(const Graph& graph);
+	NeighbourArcs CollectNeighbourArcs(const ContractionState& state,
+			VertexId vertex, bool outgoing) const;
+	void RunWitnessSearch(ContractionState& state, VertexId source,
+			VertexId excluded_vertex, const NeighbourArcs& targets,
+			Weight weight_limit, size_t settle_limit) const;
+	// returns the count of the shortcuts needed to contract the vertex,
+	// adding them to the hierarchy unless only simulating
+	size_t ContractVertex(ContractionState& state, VertexId vertex,
+			bool simulate);
+	int ComputePriority(ContractionState& state, VertexId vertex);
+	void BuildSearchGraph();
+	void UnpackArc(uint32_t arc_id, std::vector<EdgeId>& edges) const;
+	// exhaustive search up the hierarchy, forward (direction 0) or backward (1),
+	// calling visit(vertex, weight) for every settled vertex
+	template<typename Visitor>
+	void RunUpwardSearch(VertexId start, size_t direction, Visitor visit) const;
+
+	const Graph& graph_;
+	size_t vertex_count_;
+	std::vector<Arc> arcs_;
+	std::vector<size_t> ranks_;  // order of contraction
+
+	// search graph in compressed sparse row form: upward arcs grouped by their tail
+	// for the forward search, downward arcs grouped by their head for the backward one
+	std::vector<uint32_t> up_arc_offsets_;
+	std::vector<uint32_t> up_arc_ids_;
+	std::vector<uint32_t> down_arc_offsets_;
+	std::vector<uint32_t> down_arc_ids_;
+};
+
+template<typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(
+		const Graph& graph) :
+		graph_(graph), vertex_count_(graph.GetVertexCount()), ranks_(vertex_count_) {
+	assert(graph.GetEdgeCount() < NO_ARC);
+	Contract(graph);
+	BuildSearchGraph();
+}
+
+template<typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(
+		const Graph& graph, Snapshot::Reader& reader) :
+		graph_(graph), vertex_count_(graph.GetVertexCount()), arcs_(reader.ReadVector<Arc>()), ranks_(
+				reader.ReadVector<size_t>()), up_arc_offsets_(
+				reader.ReadVector<uint32_t>()), up_arc_ids_(
+				reader.ReadVector<uint32_t>()), down_arc_offsets_(
+				reader.ReadVector<uint32_t>()), down_arc_ids_(
+				reader.ReadVector<uint32_t>()) {
+}
+
+template<typename Weight>
+void ContractionHierarchyRouter<Weight>::Serialize(
+		Snapshot::Writer& writer) const {
+	writer.WriteVector(arcs_);
+	writer.WriteVector(ranks_);
+	writer.WriteVector(up_arc_offsets_);
+	writer.WriteVector(up_arc_ids_);
+	writer.WriteVector(down_arc_offsets_);
+	writer.WriteVector(down_arc_ids_);
+}
+
+template<typename Weight>
+size_t ContractionHierarchyRouter<Weight>::GetMemoryUsage() const {
+	return arcs_.capacity() * sizeof(Arc) + ranks_.capacity() * sizeof(size_t)
+			+ (up_arc_offsets_.capacity() + up_arc_ids_.capacity()
+					+ down_arc_offsets_.capacity() + down_arc_ids_.capacity())
+					* sizeof(uint32_t);
+}
+
+template<typename Weight>
+void ContractionHierarchyRouter<Weight>::UpdateRoutes(const GraphChange&) {
+	vertex_count_ = graph_.GetVertexCount();
+	assert(graph_.GetEdgeCount() < NO_ARC);
+	arcs_.clear();
+	ranks_.assign(vertex_count_, 0);
+	Contract(graph_);
+	BuildSearchGraph();
+}
+
+template<typename Weight>
+void ContractionHierarchyRouter<Weight>::Contract(const Graph& graph) {
+	ContractionState state;
+	state.in_arcs.resize(vertex_count_);
+	state.out_arcs.resize(vertex_count_);
+	state.is_contracted.assign(vertex_count_, false);
+	state.deleted_neighbour_counts.assign(vertex_count_, 0);
+	state.witness_weights.assign(vertex_count_, NO_ROUTE);
+	state.witness_search_ids.assign(vertex_count_, 0);
+	state.witness_target_search_ids.assign(vertex_count_, 0);
+
+	arcs_.assign(graph.GetEdgeCount(), { 0, 0, NO_ROUTE, NO_ARC, NO_ARC });
+	for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+		for (const auto& arc : graph.GetOutArcs(vertex)) {
+			assert(arc.weight >= 0);
+			arcs_[arc.edge_id] = { vertex, arc.to, arc.weight, NO_ARC, NO_ARC };
+			state.out_arcs[vertex].push_back(arc.edge_id);
+			state.in_arcs[arc.to].push_back(arc.edge_id);
+		}
+	}
+
+	// the least important vertices are contracted first; priorities grow as the
+	// graph gets contracted, so a popped vertex is re-evaluated before contraction
+	using QueueItem = std::pair<int, VertexId>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>,
+			std::greater<QueueItem>> queue;
+	for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+		queue.push( { ComputePriority(state, vertex), vertex });
+	}
+
+	size_t rank = 0;
+	while (!queue.empty()) {
+		const VertexId vertex = queue.top().second;
+		queue.pop();
+		const int priority = ComputePriority(state, vertex);
+		if (!queue.empty() && priority > queue.top().first) {
+			queue.push( { priority, vertex });
+			continue;
+		}
+
+		ContractVertex(state, vertex, false);
+		for (const bool outgoing : { false, true }) {
+			for (const auto& [neighbour, arc_id] : CollectNeighbourArcs(state,
+					vertex, outgoing)) {
+				++state.deleted_neighbour_counts[neighbour];
+				// the remaining graph no longer needs the arcs of the vertex
+				auto& neighbour_arcs =
+						outgoing ? state.in_arcs[neighbour] : state.out_arcs[neighbour];
+				neighbour_arcs.erase(std::remove_if(std::begin(neighbour_arcs),
+						std::end(neighbour_arcs), [this, vertex](uint32_t arc_id) {
+							return arcs_[arc_id].from == vertex
+									|| arcs_[arc_id].to == vertex;
+						}), std::end(neighbour_arcs));
+			}
+		}
+		state.is_contracted[vertex] = true;
+		ranks_[vertex] = rank++;
+	}
+}
+
+template<typename Weight>
+typename ContractionHierarchyRouter<Weight>::NeighbourArcs ContractionHierarchyRouter<
+		Weight>::CollectNeighbourArcs(const ContractionState& state,
+		VertexId vertex, bool outgoing) const {
+	// the lightest arc to or from every not yet contracted neighbour
+	NeighbourArcs result;
+	for (const uint32_t arc_id : outgoing ?
+			state.out_arcs[vertex] : state.in_arcs[vertex]) {
+		const Arc& arc = arcs_[arc_id];
+		const VertexId neighbour = outgoing ? arc.to : arc.from;
+		if (neighbour != vertex && !state.is_contracted[neighbour]) {
+			result.emplace_back(neighbour, arc_id);
+		}
+	}
+	std::sort(std::begin(result), std::end(result),
+			[this](const auto& lhs, const auto& rhs) {
+				return std::pair(lhs.first, arcs_[lhs.second].weight)
+						< std::pair(rhs.first, arcs_[rhs.second].weight);
+			});
+	result.erase(std::unique(std::begin(result), std::end(result),
+			[](const auto& lhs, const auto& rhs) {
+				return lhs.first == rhs.first;
+			}), std::end(result));
+	return result;
+}
+
+template<typename Weight>
+void ContractionHierarchyRouter<Weight>::RunWitnessSearch(
+		ContractionState& state, VertexId source, VertexId excluded_vertex,
+		const NeighbourArcs& targets, Weight weight_limit,
+		size_t settle_limit) const {
+	// Dijkstra over the remaining graph avoiding the vertex being contracted,
+	// it stops once all the targets are settled
+	const size_t search_id = ++state.witness_search_id;
+	size_t unsettled_target_count = 0;
+	for (const auto& [target, arc_id] : targets) {
+		if (target != source) {
+			state.witness_target_search_ids[target] = search_id;
+			++unsettled_target_count;
+		}
+	}
+	auto get_weight = [&state, search_id](VertexId vertex) {
+		return state.witness_search_ids[vertex] == search_id ?
+				state.witness_weights[vertex] : NO_ROUTE;
+	};
+	auto set_weight = [&state, search_id](VertexId vertex, Weight weight) {
+		state.witness_search_ids[vertex] = search_id;
+		state.witness_weights[vertex] = weight;
+	};
+
+	using QueueItem = std::pair<Weight, VertexId>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>,
+			std::greater<QueueItem>> queue;
+	set_weight(source, 0);
+	queue.push( { 0, source });
+	size_t settled_count = 0;
+	while (!queue.empty() && unsettled_target_count > 0
+			&& settled_count < settle_limit) {
+		const auto [weight, vertex] = queue.top();
+		queue.pop();
+		if (weight > get_weight(vertex)) {
+			continue;
+		}
+		if (weight > weight_limit) {
+			break;
+		}
+		++settled_count;
+		if (state.witness_target_search_ids[vertex] == search_id) {
+			--unsettled_target_count;
+		}
+		for (const uint32_t arc_id : state.out_arcs[vertex]) {
+			const Arc& arc = arcs_[arc_id];
+			if (arc.to == excluded_vertex || state.is_contracted[arc.to]) {
+				continue;
+			}
+			const Weight candidate_weight = weight + arc.weight;
+			if (candidate_weight < get_weight(arc.to)) {
+				set_weight(arc.to, candidate_weight);
+				queue.push( { candidate_weight, arc.to });
+			}
+		}
+	}
+}
+
+template<typename Weight>
+size_t ContractionHierarchyRouter<Weight>::ContractVertex(
+		ContractionState& state, VertexId vertex, bool simulate) {
+	const NeighbourArcs in_arcs = CollectNeighbourArcs(state, vertex, false);
+	const NeighbourArcs out_arcs = CollectNeighbourArcs(state, vertex, true);
+	if (in_arcs.empty() || out_arcs.empty()) {
+		return 0;
+	}
+	Weight max_out_weight = 0;
+	for (const auto& [neighbour, arc_id] : out_arcs) {
+		max_out_weight = std::max(max_out_weight, arcs_[arc_id].weight);
+	}
+
+	size_t shortcut_count = 0;
+	for (const auto& [source, in_arc_id] : in_arcs) {
+		const Weight in_weight = arcs_[in_arc_id].weight;
+		RunWitnessSearch(state, source, vertex, out_arcs,
+				in_weight + max_out_weight,
+				simulate ? SIMULATION_SETTLE_LIMIT : CONTRACTION_SETTLE_LIMIT);
+		for (const auto& [target, out_arc_id] : out_arcs) {
+			if (target == source) {
+				continue;
+			}
+			// a path through the vertex is kept unless some other path is as short
+			const Weight via_weight = in_weight + arcs_[out_arc_id].weight;
+			if (state.witness_search_ids[target] == state.witness_search_id
+					&& state.witness_weights[target] <= via_weight) {
+				continue;
+			}
+			++shortcut_count;
+			if (!simulate) {
+				const uint32_t shortcut_id = static_cast<uint32_t>(arcs_.size());
+				assert(shortcut_id < NO_ARC);
+				arcs_.push_back( { source, target, via_weight, in_arc_id,
+						out_arc_id });
+				state.out_arcs[source].push_back(shortcut_id);
+				state.in_arcs[target].push_back(shortcut_id);
+			}
+		}
+	}
+	return shortcut_count;
+}
+
+template<typename Weight>
+int ContractionHierarchyRouter<Weight>::ComputePriority(
+		ContractionState& state, VertexId vertex) {
+	// edge difference plus the count of already contracted neighbours,
+	// the latter spreads the contraction uniformly over the graph
+	const int removed_arc_count = static_cast<int>(CollectNeighbourArcs(state,
+			vertex, false).size() + CollectNeighbourArcs(state, vertex, true).size());
+	const int shortcut_count = static_cast<int>(ContractVertex(state, vertex,
+			true));
+	return shortcut_count - removed_arc_count
+			+ static_cast<int>(state.deleted_neighbour_counts[vertex]);
+}
+
+template<typename Weight>
+void ContractionHierarchyRouter<Weight>::BuildSearchGraph() {
+	up_arc_offsets_.assign(vertex_count_ + 1, 0);
+	down_arc_offsets_.assign(vertex_count_ + 1, 0);
+	auto is_upward = [this](const Arc& arc) {
+		return ranks_[arc.from] < ranks_[arc.to];
+	};
+	for (const Arc& arc : arcs_) {
+		if (arc.from == arc.to) {
+			continue;
+		}
+		if (is_upward(arc)) {
+			++up_arc_offsets_[arc.from + 1];
+		} else {
+			++down_arc_offsets_[arc.to + 1];
+		}
+	}
+	for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+		up_arc_offsets_[vertex + 1] += up_arc_offsets_[vertex];
+		down_arc_offsets_[vertex + 1] += down_arc_offsets_[vertex];
+	}
+
+	up_arc_ids_.resize(up_arc_offsets_.back());
+	down_arc_ids_.resize(down_arc_offsets_.back());
+	std::vector<uint32_t> up_positions(std::begin(up_arc_offsets_),
+			std::prev(std::end(up_arc_offsets_)));
+	std::vector<uint32_t> down_positions(std::begin(down_arc_offsets_),
+			std::prev(std::end(down_arc_offsets_)));
+	for (uint32_t arc_id = 0; arc_id < arcs_.size(); ++arc_id) {
+		const Arc& arc = arcs_[arc_id];
+		if (arc.from == arc.to) {
+			continue;
+		}
+		if (is_upward(arc)) {
+			up_arc_ids_[up_positions[arc.from]++] = arc_id;
+		} else {
+			down_arc_ids_[down_positions[arc.to]++] = arc_id;
+		}
+	}
+}
+
+template<typename Weight>
+void ContractionHierarchyRouter<Weight>::SearchSpace::Prepare(
+		size_t vertex_count) {
+	for (size_t direction = 0; direction < 2; ++direction) {
+		if (weights[direction].size() < vertex_count) {
+			weights[direction].resize(vertex_count, NO_ROUTE);
+			parent_arcs[direction].resize(vertex_count, NO_ARC);
+		}
+	}
+}
+
+template<typename Weight>
+void ContractionHierarchyRouter<Weight>::SearchSpace::Reset() {
+	for (const VertexId vertex : touched_vertices) {
+		for (size_t direction = 0; direction < 2; ++direction) {
+			weights[direction][vertex] = NO_ROUTE;
+			parent_arcs[direction][vertex] = NO_ARC;
+		}
+	}
+	touched_vertices.clear();
+}
+
+template<typename Weight>
+std::optional<typename ContractionHierarchyRouter<Weight>::ExpandedRoute> ContractionHierarchyRouter<
+		Weight>::ExpandRoute(VertexId from, VertexId to) const {
+	// the labels are reused between queries of the thread to keep them allocation-free
+	static thread_local SearchSpace search_space;
+	search_space.Prepare(vertex_count_);
+
+	using QueueItem = std::pair<Weight, VertexId>;
+	using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>,
+	std::greater<QueueItem>>;
+	Queue queues[2];
+	auto& weights = search_space.weights;
+	auto& parent_arcs = search_space.parent_arcs;
+	for (const auto& [direction, vertex] : { std::pair(0, from), std::pair(1,
+			to) }) {
+		weights[direction][vertex] = 0;
+		queues[direction].push( { 0, vertex });
+		search_space.touched_vertices.push_back(vertex);
+	}
+
+	Weight best_weight = NO_ROUTE;
+	std::optional<VertexId> meeting_vertex;
+	auto get_min_weight = [&queues](size_t direction) {
+		return queues[direction].empty() ?
+				NO_ROUTE : queues[direction].top().first;
+	};
+	while (true) {
+		// the searches alternate by the smallest tentative weight and stop
+		// when neither of them can improve the best route found so far
+		const size_t direction = get_min_weight(0) <= get_min_weight(1) ? 0 : 1;
+		if (get_min_weight(direction) >= best_weight) {
+			break;
+		}
+		const auto [weight, vertex] = queues[direction].top();
+		queues[direction].pop();
+		if (weight > weights[direction][vertex]) {
+			continue;
+		}
+		if (const Weight other_weight = weights[1 - direction][vertex]; weight
+				+ other_weight < best_weight) {
+			best_weight = weight + other_weight;
+			meeting_vertex = vertex;
+		}
+
+		const auto& offsets = direction == 0 ? up_arc_offsets_ : down_arc_offsets_;
+		const auto& arc_ids = direction == 0 ? up_arc_ids_ : down_arc_ids_;
+		for (uint32_t arc_idx = offsets[vertex]; arc_idx < offsets[vertex + 1];
+				++arc_idx) {
+			const Arc& arc = arcs_[arc_ids[arc_idx]];
+			const VertexId neighbour = direction == 0 ? arc.to : arc.from;
+			const Weight candidate_weight = weight + arc.weight;
+			if (candidate_weight < weights[direction][neighbour]) {
+				if (weights[0][neighbour] == NO_ROUTE
+						&& weights[1][neighbour] == NO_ROUTE) {
+					search_space.touched_vertices.push_back(neighbour);
+				}
+				weights[direction][neighbour] = candidate_weight;
+				parent_arcs[direction][neighbour] = arc_ids[arc_idx];
+				queues[direction].push( { candidate_weight, neighbour });
+			}
+		}
+	}
+
+	if (!meeting_vertex) {
+		search_space.Reset();
+		return std::nullopt;
+	}
+
+	// collect the arcs from the source up to the meeting vertex and from there down
+	// to the target, then replace the shortcuts with the edges they stand for
+	std::vector<uint32_t> route_arcs;
+	for (VertexId vertex = *meeting_vertex; parent_arcs[0][vertex] != NO_ARC;
+			vertex = arcs_[parent_arcs[0][vertex]].from) {
+		route_arcs.push_back(parent_arcs[0][vertex]);
+	}
+	std::reverse(std::begin(route_arcs), std::end(route_arcs));
+	for (VertexId vertex = *meeting_vertex; parent_arcs[1][vertex] != NO_ARC;
+			vertex = arcs_[parent_arcs[1][vertex]].to) {
+		route_arcs.push_back(parent_arcs[1][vertex]);
+	}
+	search_space.Reset();
+
+	std::vector<EdgeId> edges;
+	for (const uint32_t arc_id : route_arcs) {
+		UnpackArc(arc_id, edges);
+	}
+	return ExpandedRoute { best_weight, std::move(edges) };
+}
+
+// many-to-many by buckets: the backward search from every target leaves its weight
+// in a bucket at every vertex it settles, then the forward search from every source
+// collects the buckets on its way; the top vertex of an optimal route is settled
+// by both searches, so every pair meets at least there
+template<typename Weight>
+std::vector<Weight> ContractionHierarchyRouter<Weight>::ComputeWeightMatrix(
+		const std::vector<VertexId>& sources,
+		const std::vector<VertexId>& targets) const {
+	struct BucketEntry {
+		size_t target_idx;
+		Weight weight;
+	};
+	std::unordered_map<VertexId, std::vector<BucketEntry>> buckets;
+	for (size_t target_idx = 0; target_idx < targets.size(); ++target_idx) {
+		RunUpwardSearch(targets[target_idx], 1,
+				[&buckets, target_idx](VertexId vertex, Weight weight) {
+					buckets[vertex].push_back( { target_idx, weight });
+				});
+	}
+
+	std::vector<Weight> weights(sources.size() * targets.size(), NO_ROUTE);
+	for (size_t source_idx = 0; source_idx < sources.size(); ++source_idx) {
+		Weight* row = &weights[source_idx * targets.size()];
+		RunUpwardSearch(sources[source_idx], 0,
+				[&buckets, row](VertexId vertex, Weight weight) {
+					const auto it = buckets.find(vertex);
+					if (it == std::end(buckets)) {
+						return;
+					}
+					for (const BucketEntry& entry : it->second) {
+						row[entry.target_idx] = std::min(row[entry.target_idx],
+								weight + entry.weight);
+					}
+				});
+	}
+	return weights;
+}
+
+template<typename Weight>
+template<typename Visitor>
+void ContractionHierarchyRouter<Weight>::RunUpwardSearch(VertexId start,
+		size_t direction, Visitor visit) const {
+	static thread_local SearchSpace search_space;
+	search_space.Prepare(vertex_count_);
+	auto& weights = search_space.weights[direction];
+	const auto& offsets = direction == 0 ? up_arc_offsets_ : down_arc_offsets_;
+	const auto& arc_ids = direction == 0 ? up_arc_ids_ : down_arc_ids_;
+
+	using QueueItem = std::pair<Weight, VertexId>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>,
+			std::greater<QueueItem>> queue;
+	weights[start] = 0;
+	search_space.touched_vertices.push_back(start);
+	queue.push( { 0, start });
+	while (!queue.empty()) {
+		const auto [weight, vertex] = queue.top();
+		queue.pop();
+		if (weight > weights[vertex]) {
+			continue;
+		}
+		visit(vertex, weight);
+		for (uint32_t arc_idx = offsets[vertex]; arc_idx < offsets[vertex + 1];
+				++arc_idx) {
+			const Arc& arc = arcs_[arc_ids[arc_idx]];
+			const VertexId neighbour = direction == 0 ? arc.to : arc.from;
+			const Weight candidate_weight = weight + arc.weight;
+			if (candidate_weight < weights[neighbour]) {
+				if (weights[neighbour] == NO_ROUTE) {
+					search_space.touched_vertices.push_back(neighbour);
+				}
+				weights[neighbour] = candidate_weight;
+				queue.push( { candidate_weight, neighbour });
+			}
+		}
+	}
+	search_space.Reset();
+}
+
+template<typename Weight>
+void ContractionHierarchyRouter<Weight>::UnpackArc(uint32_t arc_id,
+		std::vector<EdgeId>& edges) const {
+	std::vector<uint32_t> arcs_to_unpack = { arc_id };
+	while (!arcs_to_unpack.empty()) {
+		const Arc& arc = arcs_[arcs_to_unpack.back()];
+		if (arc.first_child == NO_ARC) {
+			edges.push_back(arcs_to_unpack.back());
+			arcs_to_unpack.pop_back();
+		} else {
+			arcs_to_unpack.back() = arc.second_child;
+			arcs_to_unpack.push_back(arc.first_child);
+		}
+	}
+}
+
+}
+
+#endif /* CONTRACTION_HIERARCHY_ROUTER_H_ */
@@ -0,0 +1,190 @@
+/*
+ * csr_graph.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef CSR_GRAPH_H_
+#define CSR_GRAPH_H_
+
+#pragma once
+
+#include "general_utils.h"
+#include "graph.h"
+#include "snapshot.h"
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+namespace Graph {
+
+// frozen (immutable) form of DirectedWeightedGraph in compressed sparse row layout:
+// the out-edges of every vertex are packed contiguously with their target and
+// weight inlined, so traversals walk adjacency lists sequentially.
+// An edge with an infinite weight is a removed one: it keeps its id and can still
+// be read by GetEdge, but its arc is stored after the arcs of the last vertex,
+// out of reach of GetOutArcs
+template<typename Weight>
+class CsrGraph {
+public:
+	struct Arc {
+		uint32_t to;
+		uint32_t edge_id;
+		Weight weight;
+	};
+
+	using ArcsRange = Range<const Arc*>;
+
+	CsrGraph() = default;
+	explicit CsrGraph(const DirectedWeightedGraph<Weight>& graph);
+	// the same layout built straight from a list of edges indexed by their ids
+	CsrGraph(size_t vertex_count, const std::vector<Edge<Weight>>& edges);
+	explicit CsrGraph(Snapshot::Reader& reader);
+
+	void Serialize(Snapshot::Writer& writer) const;
+
+	size_t GetVertexCount() const;
+	size_t GetEdgeCount() const;
+	Edge<Weight> GetEdge(EdgeId edge_id) const;
+	VertexId GetEdgeSource(EdgeId edge_id) const;
+	ArcsRange GetOutArcs(VertexId vertex) const;
+
+	static bool IsRemoved(const Edge<Weight>& edge) {
+		if constexpr (std::numeric_limits<Weight>::has_infinity) {
+			return edge.weight == std::numeric_limits<Weight>::infinity();
+		} else {
+			return false;
+		}
+	}
+
+private:
+	std::vector<uint32_t> arc_offsets_ = { 0 };  // arcs of vertex v are [offsets[v], offsets[v + 1])
+	std::vector<Arc> arcs_;
+	// edge id -> its source and its position among the arcs
+	std::vector<uint32_t> edge_sources_;
+	std::vector<uint32_t> edge_arc_indices_;
+};
+
+template<typename Weight>
+CsrGraph<Weight>::CsrGraph(const DirectedWeightedGraph<Weight>& graph) {
+	const size_t vertex_count = graph.GetVertexCount();
+	const size_t edge_count = graph.GetEdgeCount();
+	assert(vertex_count < std::numeric_limits<uint32_t>::max());
+	assert(edge_count < std::numeric_limits<uint32_t>::max());
+
+	arc_offsets_.assign(vertex_count + 1, 0);
+	arcs_.reserve(edge_count);
+	edge_sources_.resize(edge_count);
+	edge_arc_indices_.resize(edge_count);
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+		// the arcs of a vertex keep the order in which its edges were added
+		for (const EdgeId edge_id : graph.GetVertexEdges(vertex)) {
+			const auto& edge = graph.GetEdge(edge_id);
+			edge_sources_[edge_id] = static_cast<uint32_t>(vertex);
+			if (IsRemoved(edge)) {
+				continue;
+			}
+			edge_arc_indices_[edge_id] = static_cast<uint32_t>(arcs_.size());
+			arcs_.push_back( { static_cast<uint32_t>(edge.to),
+					static_cast<uint32_t>(edge_id), edge.weight });
+		}
+		arc_offsets_[vertex + 1] = static_cast<uint32_t>(arcs_.size());
+	}
+	for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+		const auto& edge = graph.GetEdge(edge_id);
+		if (IsRemoved(edge)) {
+			edge_arc_indices_[edge_id] = static_cast<uint32_t>(arcs_.size());
+			arcs_.push_back( { static_cast<uint32_t>(edge.to),
+					static_cast<uint32_t>(edge_id), edge.weight });
+		}
+	}
+}
+
+template<typename Weight>
+CsrGraph<Weight>::CsrGraph(size_t vertex_count,
+		const std::vector<Edge<Weight>>& edges) {
+	const size_t edge_count = edges.size();
+	assert(vertex_count < std::numeric_limits<uint32_t>::max());
+	assert(edge_count < std::numeric_limits<uint32_t>::max());
+
+	// counting sort of the edges by their sources, stable in the edge ids
+	arc_offsets_.assign(vertex_count + 1, 0);
+	edge_sources_.resize(edge_count);
+	for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+		const auto& edge = edges[edge_id];
+		edge_sources_[edge_id] = static_cast<uint32_t>(edge.from);
+		if (!IsRemoved(edge)) {
+			++arc_offsets_[edge.from + 1];
+		}
+	}
+	for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+		arc_offsets_[vertex + 1] += arc_offsets_[vertex];
+	}
+
+	std::vector<uint32_t> arc_positions(std::begin(arc_offsets_),
+			std::prev(std::end(arc_offsets_)));
+	uint32_t removed_arc_position = arc_offsets_.back();
+	arcs_.resize(edge_count);
+	edge_arc_indices_.resize(edge_count);
+	for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+		const auto& edge = edges[edge_id];
+		const uint32_t arc_idx =
+				IsRemoved(edge) ?
+						removed_arc_position++ : arc_positions[edge.from]++;
+		edge_arc_indices_[edge_id] = arc_idx;
+		arcs_[arc_idx] = { static_cast<uint32_t>(edge.to),
+				static_cast<uint32_t>(edge_id), edge.weight };
+	}
+}
+
+template<typename Weight>
+CsrGraph<Weight>::CsrGraph(Snapshot::Reader& reader) :
+		arc_offsets_(reader.ReadVector<uint32_t>()), arcs_(
+				reader.ReadVector<Arc>()), edge_sources_(
+				reader.ReadVector<uint32_t>()), edge_arc_indices_(
+				reader.ReadVector<uint32_t>()) {
+}
+
+template<typename Weight>
+void CsrGraph<Weight>::Serialize(Snapshot::Writer& writer) const {
+	writer.WriteVector(arc_offsets_);
+	writer.WriteVector(arcs_);
+	writer.WriteVector(edge_sources_);
+	writer.WriteVector(edge_arc_indices_);
+}
+
+template<typename Weight>
+size_t CsrGraph<Weight>::GetVertexCount() const {
+	return arc_offsets_.size() - 1;
+}
+
+template<typename Weight>
+size_t CsrGraph<Weight>::GetEdgeCount() const {
+	return edge_sources_.size();
+}
+
+template<typename Weight>
+Edge<Weight> CsrGraph<Weight>::GetEdge(EdgeId edge_id) const {
+	const Arc& arc = arcs_[edge_arc_indices_[edge_id]];
+	return {edge_sources_[edge_id], arc.to, arc.weight};
+}
+
+template<typename Weight>
+VertexId CsrGraph<Weight>::GetEdgeSource(EdgeId edge_id) const {
+	return edge_sources_[edge_id];
+}
+
+template<typename Weight>
+typename CsrGraph<Weight>::ArcsRange CsrGraph<Weight>::GetOutArcs(
+		VertexId vertex) const {
+	const Arc* const arcs = arcs_.data();
+	return {arcs + arc_offsets_[vertex], arcs + arc_offsets_[vertex + 1]};
+}
+
+}
+
+#endif /* CSR_GRAPH_H_ */
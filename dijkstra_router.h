@@ -0,0 +1,183 @@
+/*
+ * dijkstra_router.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef DIJKSTRA_ROUTER_H_
+#define DIJKSTRA_ROUTER_H_
+
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "router_base.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace Graph {
+
+// on-demand router: nothing is precomputed, every query runs a single-source
+// Dijkstra search which stops as soon as the target vertex is settled
+template<typename Weight>
+class DijkstraRouter: public RouterBase<Weight> {
+private:
+	using Graph = CsrGraph<Weight>;
+	using typename RouterBase<Weight>::ExpandedRoute;
+	using typename RouterBase<Weight>::GraphChange;
+
+public:
+	explicit DijkstraRouter(const Graph& graph);
+
+	void Serialize(Snapshot::Writer& writer) const override;
+
+	size_t GetMemoryUsage() const override {
+		return 0;
+	}
+
+	// one search per source, which stops once all the targets are settled
+	std::vector<Weight> ComputeWeightMatrix(const std::vector<VertexId>& sources,
+			const std::vector<VertexId>& targets) const override;
+
+protected:
+	std::optional<ExpandedRoute> ExpandRoute(VertexId from, VertexId to) const
+			override;
+	void UpdateRoutes(const GraphChange& change) override;
+
+private:
+	const Graph& graph_;
+};
+
+template<typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph) :
+		graph_(graph) {
+}
+
+template<typename Weight>
+void DijkstraRouter<Weight>::Serialize(Snapshot::Writer&) const {
+	// nothing is precomputed
+}
+
+template<typename Weight>
+void DijkstraRouter<Weight>::UpdateRoutes(const GraphChange&) {
+	// the searches run over the graph as it is
+}
+
+template<typename Weight>
+std::vector<Weight> DijkstraRouter<Weight>::ComputeWeightMatrix(
+		const std::vector<VertexId>& sources,
+		const std::vector<VertexId>& targets) const {
+	static_assert(std::numeric_limits<Weight>::has_infinity,
+			"a missing route is encoded with an infinite weight");
+	constexpr Weight NO_ROUTE = std::numeric_limits<Weight>::infinity();
+	const size_t vertex_count = graph_.GetVertexCount();
+
+	// how many times every vertex is among the targets
+	std::vector<uint32_t> target_counts(vertex_count, 0);
+	for (const VertexId target : targets) {
+		++target_counts[target];
+	}
+
+	std::vector<Weight> weights;
+	weights.reserve(sources.size() * targets.size());
+	std::vector<Weight> vertex_weights(vertex_count, NO_ROUTE);
+	std::vector<VertexId> touched_vertices;
+	using QueueItem = std::pair<Weight, VertexId>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>,
+			std::greater<QueueItem>> queue;
+	for (const VertexId source : sources) {
+		vertex_weights[source] = 0;
+		touched_vertices.push_back(source);
+		queue.push( { 0, source });
+		size_t unsettled_target_count = targets.size();
+		while (!queue.empty() && unsettled_target_count > 0) {
+			const auto [weight, vertex] = queue.top();
+			queue.pop();
+			if (weight > vertex_weights[vertex]) {
+				continue;
+			}
+			unsettled_target_count -= target_counts[vertex];
+			for (const auto& arc : graph_.GetOutArcs(vertex)) {
+				const Weight candidate_weight = weight + arc.weight;
+				if (candidate_weight < vertex_weights[arc.to]) {
+					if (vertex_weights[arc.to] == NO_ROUTE) {
+						touched_vertices.push_back(arc.to);
+					}
+					vertex_weights[arc.to] = candidate_weight;
+					queue.push( { candidate_weight, arc.to });
+				}
+			}
+		}
+
+		for (const VertexId target : targets) {
+			weights.push_back(vertex_weights[target]);
+		}
+		for (const VertexId vertex : touched_vertices) {
+			vertex_weights[vertex] = NO_ROUTE;
+		}
+		touched_vertices.clear();
+		queue = { };
+	}
+	return weights;
+}
+
+template<typename Weight>
+std::optional<typename DijkstraRouter<Weight>::ExpandedRoute> DijkstraRouter<
+		Weight>::ExpandRoute(VertexId from, VertexId to) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	std::vector<std::optional<Weight>> weights(vertex_count);
+	std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+
+	// min-heap of (weight, vertex); outdated entries are skipped when popped
+	using QueueItem = std::pair<Weight, VertexId>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>,
+			std::greater<QueueItem>> queue;
+	weights[from] = 0;
+	queue.push( { 0, from });
+
+	while (!queue.empty()) {
+		const auto [weight, vertex] = queue.top();
+		queue.pop();
+		if (weight > *weights[vertex]) {
+			continue;
+		}
+		if (vertex == to) {
+			break;
+		}
+		for (const auto& arc : graph_.GetOutArcs(vertex)) {
+			assert(arc.weight >= 0);
+			const Weight candidate_weight = weight + arc.weight;
+			if (!weights[arc.to] || candidate_weight < *weights[arc.to]) {
+				weights[arc.to] = candidate_weight;
+				prev_edges[arc.to] = arc.edge_id;
+				queue.push( { candidate_weight, arc.to });
+			}
+		}
+	}
+
+	if (!weights[to]) {
+		return std::nullopt;
+	}
+	// collect the edges by going back along the shortest path tree
+	std::vector<EdgeId> edges;
+	for (std::optional<EdgeId> edge_id = prev_edges[to]; edge_id; edge_id =
+			prev_edges[graph_.GetEdgeSource(*edge_id)]) {
+		edges.push_back(*edge_id);
+	}
+	std::reverse(std::begin(edges), std::end(edges));
+
+	return ExpandedRoute { *weights[to], std::move(edges) };
+}
+
+}
+
+#endif /* DIJKSTRA_ROUTER_H_ */
@@ -8,6 +8,12 @@
 
 #include "distance_utils.h"
 
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 namespace Earth {
@@ -34,5 +40,68 @@ namespace Earth {
       + cos(lhs.latitude) * cos(rhs.latitude) * cos(abs(lhs.longitude - rhs.longitude))
     ) * EARTH_RADIUS;
   }
+
+  UnitVector UnitVector::FromPoint(Point point) {
+    point = Point::FromDegrees(point.latitude, point.longitude);
+    return {
+      cos(point.latitude) * cos(point.longitude),
+      cos(point.latitude) * sin(point.longitude),
+      sin(point.latitude)
+    };
+  }
+
+  // the rounding may take the dot product of close points a little past 1
+  double ComputeCentralAngle(double dot_product) {
+    return acos(min(dot_product, 1.0));
+  }
+
+  double Distance(const UnitVector& lhs, const UnitVector& rhs) {
+    return ComputeCentralAngle(lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z)
+        * EARTH_RADIUS;
+  }
+
+  double ComputeChordLength(double distance) {
+    // no two points are farther apart than half a great circle
+    return 2 * sin(min(distance / EARTH_RADIUS, PI) / 2);
+  }
+
+  double ComputeRouteDistance(const UnitVector* points, const uint32_t* route,
+      size_t route_size) {
+    double result = 0;
+    size_t segment_idx = 0;
+#ifdef __AVX2__
+    // the coordinates are gathered right from the array of points: the index
+    // of a coordinate is three times the index of its point, plus its offset
+    const double* coordinates = &points->x;
+    const __m128i three = _mm_set1_epi32(3);
+    const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    auto gather = [all_lanes](const double* base, __m128i indices) {
+      return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, indices,
+          all_lanes, 8);
+    };
+    for (; segment_idx + 4 < route_size; segment_idx += 4) {
+      const __m128i from_indices = _mm_mullo_epi32(three, _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(route + segment_idx)));
+      const __m128i to_indices = _mm_mullo_epi32(three, _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(route + segment_idx + 1)));
+      __m256d dot_products = _mm256_setzero_pd();
+      for (size_t coordinate = 0; coordinate < 3; ++coordinate) {
+        const __m256d from = gather(coordinates + coordinate, from_indices);
+        const __m256d to = gather(coordinates + coordinate, to_indices);
+        dot_products = _mm256_add_pd(dot_products, _mm256_mul_pd(from, to));
+      }
+      alignas(32) double lane_dot_products[4];
+      _mm256_store_pd(lane_dot_products, dot_products);
+      for (const double dot_product : lane_dot_products) {
+        result += ComputeCentralAngle(dot_product) * EARTH_RADIUS;
+      }
+    }
+#endif
+    for (; segment_idx + 1 < route_size; ++segment_idx) {
+      result += Distance(points[route[segment_idx]],
+          points[route[segment_idx + 1]]);
+    }
+    return result;
+  }
 }
 
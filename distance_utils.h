@@ -11,6 +11,8 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 
 namespace Earth {
 double ConvertDegreesToRadians(double degrees);
@@ -23,6 +25,29 @@ struct Point {
 };
 
 double Distance(Point lhs, Point rhs);
+
+// a point as a vector on the unit sphere, computed once per point so that
+// a distance needs no trigonometry but the final acos
+struct UnitVector {
+	double x;
+	double y;
+	double z;
+
+	static UnitVector FromPoint(Point point);
+};
+
+double Distance(const UnitVector& lhs, const UnitVector& rhs);
+
+// the straight-line distance between unit vectors of points the given distance
+// apart along the earth's surface; it grows with the distance, and is cheaper
+// to compare with than the distance itself
+double ComputeChordLength(double distance);
+
+// the length of a route through the points with the given indices, summed segment
+// by segment; the dot products are computed four segments at a time with AVX2
+// when the build targets it
+double ComputeRouteDistance(const UnitVector* points, const uint32_t* route,
+		size_t route_size);
 }
 
 #endif /* DISTANCE_UTILS_H_ */
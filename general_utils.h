@@ -12,8 +12,10 @@
 
 #include <iterator>
 #include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <variant>
 
 template<typename It>
 class Range {
@@ -55,6 +57,16 @@ const V* GetValuePointer(const std::unordered_map<K, V>& map, const K& key) {
 	}
 }
 
+// index of the alternative T in the variant type V, usable as a case label
+template<typename V, typename T, size_t Idx = 0>
+constexpr size_t GetVariantIndex() {
+	if constexpr (std::is_same_v<std::variant_alternative_t<Idx, V>, T>) {
+		return Idx;
+	} else {
+		return GetVariantIndex<V, T, Idx + 1>();
+	}
+}
+
 std::string_view Strip(std::string_view line);
 
 #endif /* GENERAL_UTILS_H_ */
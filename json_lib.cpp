@@ -7,104 +7,396 @@
 
 #include "json_lib.h"
 
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <new>
+
 using namespace std;
 
 namespace Json {
 
-Node LoadArray(istream& input) {
-	vector<Node> result;
+// the loaders consume their input from the front of the view, which points
+// into the buffer owned by the document, and allocate containers from memory
+struct LoadContext {
+	pmr::memory_resource* memory;
+	// the elements of the arrays being loaded, innermost last: each array is
+	// allocated only once its size is known, so no memory is left behind by growth
+	vector<Node> array_stack;
+};
+
+Node LoadNode(string_view& input, LoadContext& context);
+
+[[noreturn]] void ThrowParsingError(string_view input, const string& what) {
+	throw ParsingError(what + " at \""
+			+ string(input.substr(0, 16)) + "\"");
+}
+
+void SkipSpaces(string_view& input) {
+	size_t pos = 0;
+	while (pos < input.size()
+			&& (input[pos] == ' ' || input[pos] == '\n' || input[pos] == '\t'
+					|| input[pos] == '\r')) {
+		++pos;
+	}
+	input.remove_prefix(pos);
+}
+
+char PeekChar(string_view& input) {
+	// skip spaces and return the next character without consuming it
+	SkipSpaces(input);
+	if (input.empty()) {
+		ThrowParsingError(input, "unexpected end of input");
+	}
+	return input.front();
+}
 
-	for (char c; input >> c && c != ']';) {
-		if (c != ',') {
-			input.putback(c);
+void ExpectChar(string_view& input, char c) {
+	if (PeekChar(input) != c) {
+		ThrowParsingError(input, string("expected '") + c + "'");
+	}
+	input.remove_prefix(1);
+}
+
+Node LoadArray(string_view& input, LoadContext& context) {
+	Array result(context.memory);
+
+	ExpectChar(input, '[');
+	if (PeekChar(input) == ']') {
+		input.remove_prefix(1);
+		return Node(move(result));
+	}
+	const size_t stack_begin = context.array_stack.size();
+	while (true) {
+		context.array_stack.push_back(LoadNode(input, context));
+		if (PeekChar(input) == ']') {
+			input.remove_prefix(1);
+			break;
 		}
-		result.push_back(LoadNode(input));
+		ExpectChar(input, ',');
 	}
 
+	const auto elements_begin = context.array_stack.begin() + stack_begin;
+	result.reserve(context.array_stack.size() - stack_begin);
+	move(elements_begin, context.array_stack.end(), back_inserter(result));
+	context.array_stack.erase(elements_begin, context.array_stack.end());
 	return Node(move(result));
 }
 
-Node LoadBool(istream& input) {
-	string s;
-	while (isalpha(input.peek())) {
-		s.push_back(input.get());
+Node LoadBool(string_view& input) {
+	for (const auto& [word, value] : { pair { "true"sv, true },
+			pair { "false"sv, false } }) {
+		if (input.substr(0, word.size()) == word) {
+			input.remove_prefix(word.size());
+			return Node(value);
+		}
 	}
-	return Node(s == "true");
+	ThrowParsingError(input, "unexpected literal");
 }
 
-Node LoadNumber(istream& input) {
-	bool is_negative = false;
-	if (input.peek() == '-') {
-		is_negative = true;
-		input.get();
-	}
-	int int_part = 0;
-	while (isdigit(input.peek())) {
-		int_part *= 10;
-		int_part += input.get() - '0';
+Node LoadNumber(string_view& input) {
+	size_t length = 0;
+	bool is_integer = true;
+	while (length < input.size()) {
+		const char c = input[length];
+		if (c == '.' || c == 'e' || c == 'E') {
+			is_integer = false;
+		} else if (!isdigit(c) && c != '-' && c != '+') {
+			break;
+		}
+		++length;
 	}
-	if (input.peek() != '.') {
-		return Node(int_part * (is_negative ? -1 : 1));
+	const char* begin = input.data();
+	const char* end = begin + length;
+
+	if (is_integer) {
+		int value;
+		const auto [ptr, ec] = from_chars(begin, end, value);
+		if (ec == errc() && ptr == end) {
+			input.remove_prefix(length);
+			return Node(value);
+		}
+		// integers out of range fall through to doubles
 	}
-	input.get();  // '.'
-	double result = int_part;
-	double frac_mult = 0.1;
-	while (isdigit(input.peek())) {
-		result += frac_mult * (input.get() - '0');
-		frac_mult /= 10;
+	double value;
+	const auto [ptr, ec] = from_chars(begin, end, value);
+	if (ec != errc() || ptr != end) {
+		ThrowParsingError(input, "malformed number");
 	}
-	return Node(result * (is_negative ? -1 : 1));
+	input.remove_prefix(length);
+	return Node(value);
 }
 
-Node LoadString(istream& input) {
-	string line;
-	getline(input, line, '"');
-	return Node(move(line));
+void AppendUtf8(uint32_t code_point, pmr::string& output) {
+	if (code_point < 0x80) {
+		output.push_back(static_cast<char>(code_point));
+	} else if (code_point < 0x800) {
+		output.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+		output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+	} else if (code_point < 0x10000) {
+		output.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+		output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+		output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+	} else {
+		output.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+		output.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+		output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+		output.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+	}
 }
 
-Node LoadDict(istream& input) {
-	Dict result;
+// the four hex digits of a \u escape, consumed
+uint32_t LoadHexCodeUnit(string_view& input) {
+	uint32_t code_unit = 0;
+	const auto [ptr, ec] = from_chars(input.data(),
+			input.data() + min<size_t>(4, input.size()), code_unit, 16);
+	if (ec != errc() || ptr != input.data() + 4) {
+		ThrowParsingError(input, "malformed unicode escape");
+	}
+	input.remove_prefix(4);
+	return code_unit;
+}
 
-	for (char c; input >> c && c != '}';) {
-		if (c == ',') {
-			input >> c;
+pmr::string UnescapeString(string_view& input, pmr::memory_resource* memory) {
+	// slow path for strings with escapes, consumes the closing quote
+	pmr::string result(memory);
+	while (true) {
+		const size_t pos = input.find_first_of("\"\\");
+		if (pos == string_view::npos) {
+			ThrowParsingError(input, "unterminated string");
+		}
+		result.append(input.data(), pos);
+		const char c = input[pos];
+		input.remove_prefix(pos + 1);
+		if (c == '"') {
+			return result;
+		}
+		if (input.empty()) {
+			ThrowParsingError(input, "unterminated string");
 		}
+		const char escaped = input.front();
+		input.remove_prefix(1);
+		switch (escaped) {
+		case '"':
+		case '\\':
+		case '/':
+			result.push_back(escaped);
+			break;
+		case 'b':
+			result.push_back('\b');
+			break;
+		case 'f':
+			result.push_back('\f');
+			break;
+		case 'n':
+			result.push_back('\n');
+			break;
+		case 'r':
+			result.push_back('\r');
+			break;
+		case 't':
+			result.push_back('\t');
+			break;
+		case 'u': {
+			uint32_t code_point = LoadHexCodeUnit(input);
+			if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+				ThrowParsingError(input, "unpaired low surrogate");
+			}
+			if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+				// a high surrogate has to be followed by a low one, the two
+				// make up one code point beyond the basic plane
+				if (input.substr(0, 2) != "\\u") {
+					ThrowParsingError(input, "unpaired high surrogate");
+				}
+				input.remove_prefix(2);
+				const uint32_t low = LoadHexCodeUnit(input);
+				if (low < 0xDC00 || low > 0xDFFF) {
+					ThrowParsingError(input, "unpaired high surrogate");
+				}
+				code_point = 0x10000 + ((code_point - 0xD800) << 10)
+						+ (low - 0xDC00);
+			}
+			AppendUtf8(code_point, result);
+			break;
+		}
+		default:
+			ThrowParsingError(input, "unknown escape");
+		}
+	}
+}
 
-		string key = LoadString(input).AsString();
-		input >> c;
-		result.emplace(move(key), LoadNode(input));
+Node LoadString(string_view& input, LoadContext& context) {
+	ExpectChar(input, '"');
+	const size_t pos = input.find_first_of("\"\\");
+	if (pos != string_view::npos && input[pos] == '"') {
+		// fast path: no escapes, so the node views the buffer
+		const string_view result = input.substr(0, pos);
+		input.remove_prefix(pos + 1);
+		return Node(StringView { result });
+	}
+	return Node(UnescapeString(input, context.memory));
+}
+
+Node LoadDict(string_view& input, LoadContext& context) {
+	Dict result(context.memory);
+
+	ExpectChar(input, '{');
+	if (PeekChar(input) == '}') {
+		input.remove_prefix(1);
+		return Node(move(result));
+	}
+	while (true) {
+		pmr::string key(LoadString(input, context).AsString(), context.memory);
+		ExpectChar(input, ':');
+		result.emplace(move(key), LoadNode(input, context));
+		if (PeekChar(input) == '}') {
+			input.remove_prefix(1);
+			break;
+		}
+		ExpectChar(input, ',');
 	}
 
 	return Node(move(result));
 }
 
-Node LoadNode(istream& input) {
+Node LoadNode(string_view& input, LoadContext& context) {
 	// recursive calls to specific loads
-	char c;
-	input >> c;
+	const char c = PeekChar(input);
 
 	if (c == '[') {
-		return LoadArray(input);
+		return LoadArray(input, context);
 	} else if (c == '{') {
-		return LoadDict(input);
+		return LoadDict(input, context);
 	} else if (c == '"') {
-		return LoadString(input);
+		return LoadString(input, context);
 	} else if (c == 't' || c == 'f') {
-		input.putback(c);
 		return LoadBool(input);
 	} else {
-		input.putback(c);
 		return LoadNumber(input);
 	}
 }
 
-Document Load(istream& input) {
-	return Document { LoadNode(input) };
+Document::Document(Node root, shared_ptr<const string> buffer,
+		unique_ptr<pmr::monotonic_buffer_resource> arena) :
+		buffer(move(buffer)), arena(move(arena)), root(
+				new (this->arena->allocate(sizeof(Node), alignof(Node))) Node(
+						move(root)), RootDeleter { true }) {
+}
+
+Document Load(istream& input, MemoryMode memory_mode) {
+	string text(istreambuf_iterator<char>(input), {});
+	return Load(move(text), memory_mode);
+}
+
+Document Load(string text, MemoryMode memory_mode) {
+	// the buffer is shared so that moving the document keeps the views valid
+	auto buffer = make_shared<const string>(move(text));
+	string_view input = *buffer;
+	unique_ptr<pmr::monotonic_buffer_resource> arena;
+	if (memory_mode == MemoryMode::Arena) {
+		// the first block of the arena is sized after the input text
+		arena = make_unique<pmr::monotonic_buffer_resource>(
+				buffer->size() / 4 + 1024);
+	}
+	LoadContext context { arena ?
+			arena.get() : pmr::new_delete_resource() };
+
+	Node root = LoadNode(input, context);
+	SkipSpaces(input);
+	if (!input.empty()) {
+		ThrowParsingError(input, "trailing characters");
+	}
+	return arena ?
+			Document(move(root), move(buffer), move(arena)) :
+			Document(move(root), move(buffer));
+}
+
+// which characters are escaped in strings: quotes, backslashes and controls
+constexpr array<bool, 256> MakeEscapeTable() {
+	array<bool, 256> table {};
+	for (size_t c = 0; c < 0x20; ++c) {
+		table[c] = true;
+	}
+	table['"'] = true;
+	table['\\'] = true;
+	return table;
+}
+
+constexpr array<bool, 256> NEEDS_ESCAPE = MakeEscapeTable();
+
+void AppendQuotedString(string_view value, string& output) {
+	const auto first_to_escape = find_if(begin(value), end(value), [](char c) {
+		return NEEDS_ESCAPE[static_cast<unsigned char>(c)];
+	});
+	if (first_to_escape == end(value)) {
+		// fast path: nothing to escape, which is the case for almost every string
+		output.push_back('"');
+		output += value;
+		output.push_back('"');
+		return;
+	}
+	output.push_back('"');
+	static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+	output.append(begin(value), first_to_escape);
+	for (auto it = first_to_escape; it != end(value); ++it) {
+		const char c = *it;
+		switch (c) {
+		case '"':
+			output += "\\\"";
+			break;
+		case '\\':
+			output += "\\\\";
+			break;
+		case '\b':
+			output += "\\b";
+			break;
+		case '\f':
+			output += "\\f";
+			break;
+		case '\n':
+			output += "\\n";
+			break;
+		case '\r':
+			output += "\\r";
+			break;
+		case '\t':
+			output += "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				output += "\\u00";
+				output.push_back(HEX_DIGITS[c >> 4]);
+				output.push_back(HEX_DIGITS[c & 0xf]);
+			} else {
+				output.push_back(c);
+			}
+		}
+	}
+	output.push_back('"');
+}
+
+void PrintString(string_view value, ostream& output) {
+	string quoted;
+	AppendQuotedString(value, quoted);
+	output << quoted;
 }
 
 template<>
 void PrintValue<string>(const string& value, ostream& output) {
-	output << '"' << value << '"';
+	PrintString(value, output);
+}
+
+template<>
+void PrintValue<pmr::string>(const pmr::string& value, ostream& output) {
+	PrintString(value, output);
+}
+
+template<>
+void PrintValue<StringView>(const StringView& value, ostream& output) {
+	PrintString(value.value, output);
 }
 
 template<>
@@ -113,8 +405,7 @@ void PrintValue<bool>(const bool& value, std::ostream& output) {
 }
 
 template<>
-void PrintValue<std::vector<Node>>(const std::vector<Node>& nodes,
-		std::ostream& output) {
+void PrintValue<Array>(const Array& nodes, std::ostream& output) {
 	output << '[';
 	bool first = true;
 	for (const Node& node : nodes) {
@@ -152,5 +443,112 @@ void Print(const Document& document, ostream& output) {
 	PrintNode(document.GetRoot(), output);
 }
 
+void Writer::BeginValue() {
+	if (needs_separator_) {
+		buffer_ += ", ";
+	}
+	needs_separator_ = true;
+}
+
+Writer& Writer::BeginDict() {
+	BeginValue();
+	buffer_.push_back('{');
+	needs_separator_ = false;
+	return *this;
+}
+
+Writer& Writer::EndDict() {
+	buffer_.push_back('}');
+	needs_separator_ = true;
+	return *this;
+}
+
+Writer& Writer::BeginArray() {
+	BeginValue();
+	buffer_.push_back('[');
+	needs_separator_ = false;
+	return *this;
+}
+
+Writer& Writer::EndArray() {
+	buffer_.push_back(']');
+	needs_separator_ = true;
+	return *this;
+}
+
+Writer& Writer::Key(string_view key) {
+	String(key);
+	buffer_ += ": ";
+	needs_separator_ = false;
+	return *this;
+}
+
+Writer& Writer::String(string_view value) {
+	BeginValue();
+	AppendQuotedString(value, buffer_);
+	return *this;
+}
+
+Writer& Writer::Int(int value) {
+	BeginValue();
+	char chars[16];
+	const auto result = to_chars(begin(chars), end(chars), value);
+	buffer_.append(chars, result.ptr);
+	return *this;
+}
+
+Writer& Writer::Int(int64_t value) {
+	BeginValue();
+	char chars[24];
+	const auto result = to_chars(begin(chars), end(chars), value);
+	buffer_.append(chars, result.ptr);
+	return *this;
+}
+
+Writer& Writer::Double(double value) {
+	// the same as the default ostream formatting, i.e. %g with 6 digits
+	BeginValue();
+	char chars[32];
+	const auto result = to_chars(begin(chars), end(chars), value,
+			chars_format::general, 6);
+	buffer_.append(chars, result.ptr);
+	return *this;
+}
+
+Writer& Writer::Bool(bool value) {
+	BeginValue();
+	buffer_ += value ? "true" : "false";
+	return *this;
+}
+
+Writer& Writer::Null() {
+	BeginValue();
+	buffer_ += "null";
+	return *this;
+}
+
+Writer& Writer::Raw(string_view json) {
+	BeginValue();
+	buffer_ += json;
+	return *this;
+}
+
+Writer& Writer::Raw(string_view json_head, int value, string_view json_tail) {
+	BeginValue();
+	buffer_ += json_head;
+	char chars[16];
+	const auto result = to_chars(begin(chars), end(chars), value);
+	buffer_.append(chars, result.ptr);
+	buffer_ += json_tail;
+	return *this;
+}
+
+void Writer::Flush(bool force) {
+	if (output_ && (force || buffer_.size() >= FLUSH_THRESHOLD)) {
+		output_->write(buffer_.data(), buffer_.size());
+		buffer_.clear();
+	}
+}
+
 }
 
@@ -10,19 +10,34 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
 
 namespace Json {
 
+// the containers of a node take their memory from a memory resource, which is
+// either the heap or the arena of the document
 class Node;
-using Dict = std::map<std::string, Node>;
+using Array = std::pmr::vector<Node>;
+using Dict = std::pmr::map<std::pmr::string, Node, std::less<>>;
 
-class Node: std::variant<std::vector<Node>, Dict, bool, int, double, std::string> {
+// strings without escapes are kept as views into the buffer of their document;
+// a type of its own, so that no other string converts into a view implicitly
+struct StringView {
+	std::string_view value;
+};
+
+class Node: std::variant<Array, Dict, bool, int, double, std::pmr::string,
+		StringView> {
 public:
 	using variant::variant;
 	const variant& GetBase() const {
@@ -31,7 +46,7 @@ public:
 
 	const auto& AsArray() const {
 		// return a node as a vector
-		return std::get<std::vector<Node>>(*this);
+		return std::get<Array>(*this);
 	}
 
 	const auto& AsMap() const {
@@ -55,29 +70,71 @@ public:
 				std::get<double>(*this) : std::get<int>(*this);
 	}
 
-	const auto& AsString() const {
-		// return a node as a string
-		return std::get<std::string>(*this);
+	std::string_view AsString() const {
+		// return a node as a string, be it owned or a view
+		if (const auto* view = std::get_if<StringView>(this)) {
+			return view->value;
+		}
+		return std::get<std::pmr::string>(*this);
 	}
 };
 
 class Document {
 public:
 	explicit Document(Node root) :
-			root(move(root)) {
+			root(new Node(move(root)), RootDeleter { false }) {
 	}
 
+	// the buffer holds the characters which the string nodes view
+	Document(Node root, std::shared_ptr<const std::string> buffer) :
+			buffer(move(buffer)), root(new Node(move(root)), RootDeleter { false }) {
+	}
+
+	// the nodes are allocated in the arena and are released all at once with it,
+	// without being destroyed one by one
+	Document(Node root, std::shared_ptr<const std::string> buffer,
+			std::unique_ptr<std::pmr::monotonic_buffer_resource> arena);
+
 	const Node& GetRoot() const {
-		return root;
+		return *root;
 	}
 
 private:
-	Node root;
+	struct RootDeleter {
+		bool is_in_arena;
+
+		void operator()(Node* node) const {
+			if (!is_in_arena) {
+				delete node;
+			}
+		}
+	};
+
+	// the root goes first on destruction, then the arena and the buffer
+	std::shared_ptr<const std::string> buffer;
+	std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+	std::unique_ptr<Node, RootDeleter> root;
+};
+
+struct ParsingError: std::runtime_error {
+	using runtime_error::runtime_error;
+};
+
+// where the nodes of a loaded document are allocated
+enum class MemoryMode {
+	Heap,  // each container separately
+	Arena,  // in one arena of the document, released in one step
 };
 
-Node LoadNode(std::istream& input);
+// the input is read whole into a buffer and parsed in a single pass over it;
+// throws ParsingError on malformed input
+Document Load(std::istream& input, MemoryMode memory_mode = MemoryMode::Heap);
 
-Document Load(std::istream& input);
+Document Load(std::string text, MemoryMode memory_mode = MemoryMode::Heap);
+
+// appends the string in quotes, with quotes, backslashes and control
+// characters escaped; used by every printer and by Writer
+void AppendQuotedString(std::string_view value, std::string& output);
 
 void PrintNode(const Node& node, std::ostream& output);
 
@@ -89,18 +146,78 @@ void PrintValue(const Value& value, std::ostream& output) {
 template<>
 void PrintValue<std::string>(const std::string& value, std::ostream& output);
 
+template<>
+void PrintValue<std::pmr::string>(const std::pmr::string& value,
+		std::ostream& output);
+
+template<>
+void PrintValue<StringView>(const StringView& value, std::ostream& output);
+
 template<>
 void PrintValue<bool>(const bool& value, std::ostream& output);
 
 template<>
-void PrintValue<std::vector<Node>>(const std::vector<Node>& nodes,
-		std::ostream& output);
+void PrintValue<Array>(const Array& nodes, std::ostream& output);
 
 template<>
 void PrintValue<Dict>(const Dict& dict, std::ostream& output);
 
 void Print(const Document& document, std::ostream& output);
 
+// writes json text straight into a buffer, without building nodes; the text is
+// laid out the same way as by Print. With a stream given, Flush hands the
+// buffer over to it once it grows past FLUSH_THRESHOLD
+class Writer {
+public:
+	static constexpr size_t FLUSH_THRESHOLD = 1 << 16;
+
+	Writer() = default;
+
+	explicit Writer(std::ostream& output) :
+			output_(&output) {
+	}
+
+	Writer& BeginDict();
+	Writer& EndDict();
+	Writer& BeginArray();
+	Writer& EndArray();
+
+	Writer& Key(std::string_view key);
+
+	Writer& String(std::string_view value);
+	Writer& Int(int value);
+	Writer& Int(int64_t value);
+	Writer& Double(double value);
+	Writer& Bool(bool value);
+	Writer& Null();
+
+	// splices a value (or several comma separated values) already in json form
+	Writer& Raw(std::string_view json);
+
+	// splices a value already in json form in two parts with an int between them,
+	// e.g. a response rendered ahead around its request id
+	Writer& Raw(std::string_view json_head, int value,
+			std::string_view json_tail);
+
+	void Flush(bool force = false);
+
+	std::string_view GetText() const {
+		return buffer_;
+	}
+
+	void Clear() {
+		buffer_.clear();
+		needs_separator_ = false;
+	}
+
+private:
+	void BeginValue();
+
+	std::ostream* output_ = nullptr;
+	std::string buffer_;
+	bool needs_separator_ = false;
+};
+
 }
 
 #endif /* JSON_LIB_H_ */
@@ -0,0 +1,200 @@
+/*
+ * lazy_row_router.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef LAZY_ROW_ROUTER_H_
+#define LAZY_ROW_ROUTER_H_
+
+#pragma once
+
+#include "csr_graph.h"
+#include "graph.h"
+#include "lru_cache.h"
+#include "router_base.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace Graph {
+
+// all-pairs router computed lazily: the first route from a source runs one
+// Dijkstra search over the whole graph, and its shortest path tree is kept as
+// the source's row of the all-pairs table, so that the later routes from the
+// source are only walks back along the row. At most row_cache_size rows are
+// kept, the least recently used one is evicted. Two queries missing the same
+// row at once both compute it, the rows being the same
+template<typename Weight>
+class LazyRowRouter: public RouterBase<Weight> {
+private:
+	using Graph = CsrGraph<Weight>;
+	using typename RouterBase<Weight>::ExpandedRoute;
+	using typename RouterBase<Weight>::GraphChange;
+
+public:
+	LazyRowRouter(const Graph& graph, size_t row_cache_size);
+
+	// the rows are not saved, a loaded router starts with none
+	void Serialize(Snapshot::Writer& writer) const override;
+
+	size_t GetMemoryUsage() const override;
+
+	// the rows of the sources are computed (or found) one after another
+	std::vector<Weight> ComputeWeightMatrix(const std::vector<VertexId>& sources,
+			const std::vector<VertexId>& targets) const override;
+
+	// the rows of the first row_cache_size sources are computed concurrently
+	void WarmUp(const std::vector<VertexId>& sources, ThreadPool& thread_pool)
+			override;
+
+protected:
+	std::optional<ExpandedRoute> ExpandRoute(VertexId from, VertexId to) const
+			override;
+	void UpdateRoutes(const GraphChange& change) override;
+
+private:
+	static constexpr Weight NO_ROUTE = std::numeric_limits<Weight>::infinity();
+	static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
+	// the shortest path tree from a source, by vertex
+	struct Row {
+		std::vector<Weight> weights;  // NO_ROUTE for unreachable vertices
+		std::vector<uint32_t> prev_edges;  // NO_EDGE for the source and unreachable vertices
+	};
+
+	std::shared_ptr<const Row> GetRow(VertexId source) const;
+	std::shared_ptr<const Row> ComputeRow(VertexId source) const;
+
+	const Graph& graph_;
+	mutable LruCache<VertexId, std::shared_ptr<const Row>> rows_;
+};
+
+template<typename Weight>
+LazyRowRouter<Weight>::LazyRowRouter(const Graph& graph,
+		size_t row_cache_size) :
+		graph_(graph), rows_(row_cache_size) {
+	static_assert(std::numeric_limits<Weight>::has_infinity,
+			"a missing route is encoded with an infinite weight");
+}
+
+template<typename Weight>
+void LazyRowRouter<Weight>::Serialize(Snapshot::Writer&) const {
+	// the rows are recomputed on demand
+}
+
+template<typename Weight>
+size_t LazyRowRouter<Weight>::GetMemoryUsage() const {
+	// every row kept spans the whole graph
+	return rows_.GetSize() * graph_.GetVertexCount()
+			* (sizeof(Weight) + sizeof(uint32_t));
+}
+
+template<typename Weight>
+void LazyRowRouter<Weight>::UpdateRoutes(const GraphChange&) {
+	// any row may have gone through a changed edge
+	rows_.Clear();
+}
+
+template<typename Weight>
+void LazyRowRouter<Weight>::WarmUp(const std::vector<VertexId>& sources,
+		ThreadPool& thread_pool) {
+	// the rows of more sources would only evict each other
+	const size_t source_count = std::min(sources.size(), rows_.GetCapacity());
+	thread_pool.ParallelFor(source_count, [this, &sources](size_t source_idx) {
+		rows_.Insert(sources[source_idx], ComputeRow(sources[source_idx]));
+	});
+}
+
+template<typename Weight>
+std::shared_ptr<const typename LazyRowRouter<Weight>::Row> LazyRowRouter<
+		Weight>::GetRow(VertexId source) const {
+	if (auto row = rows_.Find(source)) {
+		return std::move(*row);
+	}
+	auto row = ComputeRow(source);
+	rows_.Insert(source, row);
+	return row;
+}
+
+template<typename Weight>
+std::shared_ptr<const typename LazyRowRouter<Weight>::Row> LazyRowRouter<
+		Weight>::ComputeRow(VertexId source) const {
+	const size_t vertex_count = graph_.GetVertexCount();
+	assert(graph_.GetEdgeCount() < NO_EDGE);
+	auto row = std::make_shared<Row>();
+	row->weights.assign(vertex_count, NO_ROUTE);
+	row->prev_edges.assign(vertex_count, NO_EDGE);
+
+	// min-heap of (weight, vertex); outdated entries are skipped when popped
+	using QueueItem = std::pair<Weight, VertexId>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>,
+			std::greater<QueueItem>> queue;
+	row->weights[source] = 0;
+	queue.push( { 0, source });
+	while (!queue.empty()) {
+		const auto [weight, vertex] = queue.top();
+		queue.pop();
+		if (weight > row->weights[vertex]) {
+			continue;
+		}
+		for (const auto& arc : graph_.GetOutArcs(vertex)) {
+			assert(arc.weight >= 0);
+			const Weight candidate_weight = weight + arc.weight;
+			if (candidate_weight < row->weights[arc.to]) {
+				row->weights[arc.to] = candidate_weight;
+				row->prev_edges[arc.to] = arc.edge_id;
+				queue.push( { candidate_weight, arc.to });
+			}
+		}
+	}
+	return row;
+}
+
+template<typename Weight>
+std::vector<Weight> LazyRowRouter<Weight>::ComputeWeightMatrix(
+		const std::vector<VertexId>& sources,
+		const std::vector<VertexId>& targets) const {
+	std::vector<Weight> weights;
+	weights.reserve(sources.size() * targets.size());
+	for (const VertexId source : sources) {
+		const auto row = GetRow(source);
+		for (const VertexId target : targets) {
+			weights.push_back(row->weights[target]);
+		}
+	}
+	return weights;
+}
+
+template<typename Weight>
+std::optional<typename LazyRowRouter<Weight>::ExpandedRoute> LazyRowRouter<
+		Weight>::ExpandRoute(VertexId from, VertexId to) const {
+	const auto row = GetRow(from);
+	if (row->weights[to] == NO_ROUTE) {
+		return std::nullopt;
+	}
+	// collect the edges by going back along the shortest path tree
+	std::vector<EdgeId> edges;
+	for (uint32_t edge_id = row->prev_edges[to]; edge_id != NO_EDGE; edge_id =
+			row->prev_edges[graph_.GetEdgeSource(edge_id)]) {
+		edges.push_back(edge_id);
+	}
+	std::reverse(std::begin(edges), std::end(edges));
+
+	return ExpandedRoute { row->weights[to], std::move(edges) };
+}
+
+}
+
+#endif /* LAZY_ROW_ROUTER_H_ */
@@ -0,0 +1,103 @@
+/*
+ * lru_cache.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef LRU_CACHE_H_
+#define LRU_CACHE_H_
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+// size-bounded map which evicts the least recently used entry when full;
+// all the methods are thread-safe, values are returned by copy, so they should
+// be cheap to copy (e.g. shared pointers)
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+	};
+
+	// a cache of capacity 0 stores nothing
+	explicit LruCache(size_t capacity) :
+			capacity_(capacity) {
+	}
+
+	// counts a hit or a miss; a found entry becomes the most recently used one
+	std::optional<Value> Find(const Key& key) {
+		std::lock_guard lock(mutex_);
+		const auto it = index_.find(key);
+		if (it == std::end(index_)) {
+			++stats_.misses;
+			return std::nullopt;
+		}
+		++stats_.hits;
+		entries_.splice(std::begin(entries_), entries_, it->second);
+		return it->second->second;
+	}
+
+	// an entry already present is replaced
+	void Insert(const Key& key, Value value) {
+		if (capacity_ == 0) {
+			return;
+		}
+		std::lock_guard lock(mutex_);
+		if (const auto it = index_.find(key); it != std::end(index_)) {
+			it->second->second = std::move(value);
+			entries_.splice(std::begin(entries_), entries_, it->second);
+			return;
+		}
+		if (entries_.size() == capacity_) {
+			index_.erase(entries_.back().first);
+			entries_.pop_back();
+			++stats_.evictions;
+		}
+		entries_.emplace_front(key, std::move(value));
+		index_.emplace(key, std::begin(entries_));
+	}
+
+	// the counters are kept
+	void Clear() {
+		std::lock_guard lock(mutex_);
+		index_.clear();
+		entries_.clear();
+	}
+
+	Stats GetStats() const {
+		std::lock_guard lock(mutex_);
+		return stats_;
+	}
+
+	size_t GetCapacity() const {
+		return capacity_;
+	}
+
+	size_t GetSize() const {
+		std::lock_guard lock(mutex_);
+		return entries_.size();
+	}
+
+private:
+	using Entries = std::list<std::pair<Key, Value>>;
+
+	const size_t capacity_;
+	mutable std::mutex mutex_;
+	Entries entries_;  // the most recently used first
+	std::unordered_map<Key, typename Entries::iterator, Hash> index_;
+	Stats stats_;
+};
+
+#endif /* LRU_CACHE_H_ */
@@ -9,26 +9,141 @@
 #include "json_lib.h"
 #include "queries.h"
 #include "distance_utils.h"
+#include "perf_stats.h"
+#include "server.h"
+#include "thread_pool.h"
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <string_view>
 #include "general_utils.h"
 #include "transport_register.h"
 
 using namespace std;
 
-int main() {
-	const auto input_doc = Json::Load(cin);
+// usage: transport_register [--save-snapshot FILE | --load-snapshot FILE]
+//     [--input FILE] [--serve | --socket PATH] < input.json
+//   --save-snapshot: the register built from base_requests is also saved to FILE
+//   --load-snapshot: the register is loaded from FILE, the input needs only stat_requests
+//   --input: the input is read from FILE instead of stdin
+//   --serve: after stat_requests, newline-delimited requests are read from stdin and
+//     answered line by line until its end; the input has to come from --input then
+//   --socket: the same requests are served to concurrent clients of a unix domain
+//     socket at PATH until SIGINT or SIGTERM
+// update_requests, if any, are applied to the built or loaded register before it is saved
+int main(int argc, char* argv[]) {
+	string save_snapshot_path;
+	string load_snapshot_path;
+	string input_path;
+	string socket_path;
+	bool serve_stdin = false;
+	for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+		const string_view option = argv[arg_idx];
+		if (option == "--serve") {
+			serve_stdin = true;
+			continue;
+		}
+		string* value = option == "--save-snapshot" ? &save_snapshot_path :
+						option == "--load-snapshot" ? &load_snapshot_path :
+						option == "--input" ? &input_path :
+						option == "--socket" ? &socket_path : nullptr;
+		if (!value || arg_idx + 1 == argc) {
+			cerr << "unknown option or no value: " << option << endl;
+			return 1;
+		}
+		*value = argv[++arg_idx];
+	}
+	if (serve_stdin && input_path.empty()) {
+		cerr << "--serve reads requests from stdin, the input needs --input" << endl;
+		return 1;
+	}
+
+	ifstream input_file;
+	if (!input_path.empty()) {
+		input_file.open(input_path);
+		if (!input_file) {
+			cerr << "cannot open " << input_path << endl;
+			return 1;
+		}
+	}
+	const Stopwatch parse_stopwatch;
+	const auto input_doc = Json::Load(
+			input_path.empty() ? cin : static_cast<istream&>(input_file),
+			Json::MemoryMode::Arena);
+	const auto parse_duration = parse_stopwatch.GetElapsed();
 	const auto& input_map = input_doc.GetRoot().AsMap();
 
-	const TransportRegister db(
-			BusOrStopInfo::ReadBusOrStopInfo(
-					input_map.at("base_requests").AsArray()),
-			input_map.at("routing_settings").AsMap());
+	// the register is built and stat requests are answered by "threads" threads
+	// (default 1, 0 for all hardware threads)
+	const Json::Dict* execution_settings = nullptr;
+	if (const auto it = input_map.find("execution_settings"); it
+			!= input_map.end()) {
+		execution_settings = &it->second.AsMap();
+	}
+	const size_t thread_count = execution_settings ?
+			Settings::ReadCount(*execution_settings, "threads", 1) : 1;
+	ThreadPool thread_pool(thread_count);
+
+	TransportRegister db =
+			!load_snapshot_path.empty() ?
+					TransportRegister::LoadSnapshot(load_snapshot_path) :
+					TransportRegister(
+							BusOrStopInfo::ReadBusOrStopInfo(
+									input_map.at("base_requests").AsArray()),
+							input_map.at("routing_settings").AsMap(), thread_pool);
+	db.GetPerfStats().RecordPhase(PerfStats::Phase::Parse, parse_duration);
+	if (const auto it = input_map.find("update_requests"); it
+			!= input_map.end()) {
+		db.ApplyUpdates(Updates::ReadUpdates(it->second.AsArray()), thread_pool);
+	}
+	if (!save_snapshot_path.empty()) {
+		db.SaveSnapshot(save_snapshot_path);
+	}
+
+	// the routes from the "route_warm_up_stops" are computed ahead by the routers
+	// which would compute them on demand
+	if (execution_settings && execution_settings->count("route_warm_up_stops") > 0) {
+		vector<string> stops_from;
+		for (const auto& stop_node : execution_settings->at("route_warm_up_stops")
+				.AsArray()) {
+			stops_from.emplace_back(stop_node.AsString());
+		}
+		db.WarmUpRoutes(stops_from, thread_pool);
+	}
+
+	// with "prerender_responses" the Stop and Bus responses are rendered ahead
+	if (execution_settings && execution_settings->count("prerender_responses") > 0
+			&& execution_settings->at("prerender_responses").AsBool()) {
+		Queries::RenderResponses(db, thread_pool);
+	}
 
-	Json::PrintValue(
-			Queries::ProcessAll(db, input_map.at("stat_requests").AsArray()),
-			cout);
-	cout << endl;
+	// "route_cache_size" finished routes are kept for repeated Route requests
+	if (execution_settings && execution_settings->count("route_cache_size") > 0) {
+		db.SetRouteCacheCapacity(Settings::ReadCount(*execution_settings,
+				"route_cache_size", TransportRegister::DEFAULT_ROUTE_CACHE_CAPACITY));
+	}
+
+	if (input_map.count("stat_requests") > 0) {
+		Queries::ProcessAll(db, input_map.at("stat_requests").AsArray(),
+				thread_pool, cout);
+		cout << endl;
+	}
+
+	if (serve_stdin) {
+		Server::ServeStream(db, cin, cout);
+	} else if (!socket_path.empty()) {
+		Server::ServeUnixSocket(db, socket_path);
+	}
+
+	// with "dump_stats" the stats, as a Stats request reports them, go to stderr at exit
+	if (execution_settings && execution_settings->count("dump_stats") > 0
+			&& execution_settings->at("dump_stats").AsBool()) {
+		Json::Writer writer(cerr);
+		writer.BeginDict();
+		db.WriteStats(writer);
+		writer.EndDict().Flush(true);
+		cerr << endl;
+	}
 
 	return 0;
 }
-
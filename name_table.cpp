@@ -0,0 +1,49 @@
+/*
+ * name_table.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "name_table.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+NameTable::NameTable(Snapshot::Reader& reader) {
+	const size_t name_count = reader.Read<uint64_t>();
+	for (size_t name_idx = 0; name_idx < name_count; ++name_idx) {
+		Intern(reader.ReadString());
+	}
+}
+
+void NameTable::Serialize(Snapshot::Writer& writer) const {
+	writer.Write<uint64_t>(names_.size());
+	for (const string& name : names_) {
+		writer.WriteString(name);
+	}
+}
+
+NameId NameTable::Intern(string_view name) {
+	if (const auto it = ids_.find(name); it != ids_.end()) {
+		return it->second;
+	}
+	const NameId id = names_.size();
+	ids_.emplace(names_.emplace_back(name), id);
+	return id;
+}
+
+optional<NameId> NameTable::Find(string_view name) const {
+	if (const auto it = ids_.find(name); it != ids_.end()) {
+		return it->second;
+	}
+	return nullopt;
+}
+
+NameId NameTable::GetId(string_view name) const {
+	if (const auto id = Find(name)) {
+		return *id;
+	}
+	throw out_of_range("unknown name: " + string(name));
+}
@@ -0,0 +1,60 @@
+/*
+ * name_table.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef NAME_TABLE_H_
+#define NAME_TABLE_H_
+
+#pragma once
+
+#include "snapshot.h"
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using NameId = uint32_t;
+
+// interning table of names: every distinct name is stored once and gets a dense
+// id in the order of interning. The table is movable but not copyable, since
+// its index views the stored names
+class NameTable {
+public:
+	NameTable() = default;
+	explicit NameTable(Snapshot::Reader& reader);
+
+	NameTable(const NameTable&) = delete;
+	NameTable& operator=(const NameTable&) = delete;
+	NameTable(NameTable&&) = default;
+	NameTable& operator=(NameTable&&) = default;
+
+	void Serialize(Snapshot::Writer& writer) const;
+
+	// returns the id of the name, adding the name if it is new
+	NameId Intern(std::string_view name);
+
+	std::optional<NameId> Find(std::string_view name) const;
+
+	// throws std::out_of_range for an unknown name
+	NameId GetId(std::string_view name) const;
+
+	std::string_view GetName(NameId id) const {
+		return names_[id];
+	}
+
+	size_t GetSize() const {
+		return names_.size();
+	}
+
+private:
+	std::deque<std::string> names_;  // a deque keeps the names in place as it grows
+	std::unordered_map<std::string_view, NameId> ids_;
+};
+
+#endif /* NAME_TABLE_H_ */
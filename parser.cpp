@@ -7,72 +7,168 @@
 
 #include "parser.h"
 
+#include <stdexcept>
+
 using namespace std;
 
+namespace {
+// a route which is not a roundtrip goes back the same way
+template<typename StopRef>
+void CompleteRoute(vector<StopRef>& stops, bool is_roundtrip) {
+	if (is_roundtrip || stops.size() <= 1) {
+		return;
+	}
+	for (size_t stop_idx = stops.size() - 1; stop_idx > 0; --stop_idx) {
+		stops.push_back(stops[stop_idx - 1]);  // end stop is not repeated
+	}
+}
+}
+
 namespace BusOrStopInfo {
 
-Stop Stop::ParseFrom(const Json::Dict& attrs) {
-	Stop stop = { .name = attrs.at("name").AsString(), .position = { .latitude =
-			attrs.at("latitude").AsDouble(), .longitude =
-			attrs.at("longitude").AsDouble(), } };
+Stop Stop::ParseFrom(const Json::Dict& attrs, const NameTable& stop_names) {
+	Stop stop = { .id = stop_names.GetId(attrs.at("name").AsString()),
+			.position = { .latitude = attrs.at("latitude").AsDouble(),
+					.longitude = attrs.at("longitude").AsDouble(), } };
 	if (attrs.count("road_distances") > 0) {
 		for (const auto& stop_node_pair : attrs.at("road_distances").AsMap()) {
-			stop.distances[stop_node_pair.first] =
-					stop_node_pair.second.AsInt();
+			// distances to stops which are not declared can never be used
+			if (const auto stop_id = stop_names.Find(stop_node_pair.first)) {
+				stop.distances[*stop_id] = stop_node_pair.second.AsInt();
+			}
 		}
 	}
 	return stop;
 }
 
-vector<string> ParseStops(const vector<Json::Node>& stop_nodes,
-		bool is_roundtrip) {
-	// array of stops as strings
-	vector<string> stops;
-	stops.reserve(stop_nodes.size());
+vector<StopId> ParseStops(const Json::Array& stop_nodes,
+		bool is_roundtrip, const NameTable& stop_names) {
+	// array of stops as ids
+	vector<StopId> stops;
+	stops.reserve(is_roundtrip ? stop_nodes.size() : stop_nodes.size() * 2);
 	for (const Json::Node& stop_node : stop_nodes) {
-		stops.push_back(stop_node.AsString());
-	}
-	if (is_roundtrip || stops.size() <= 1) {
-		return stops;
-	}
-	stops.reserve(stops.size() * 2 - 1);  // end stop is not repeated
-	for (size_t stop_idx = stops.size() - 1; stop_idx > 0; --stop_idx) {
-		stops.push_back(stops[stop_idx - 1]);
+		stops.push_back(stop_names.GetId(stop_node.AsString()));
 	}
+	CompleteRoute(stops, is_roundtrip);
 	return stops;
 }
 
 int ComputeStopsDistance(const Stop& lhs, const Stop& rhs) {
 	// find the distance between one stop and another
-	if (auto it = lhs.distances.find(rhs.name); it != lhs.distances.end()) {
+	if (auto it = lhs.distances.find(rhs.id); it != lhs.distances.end()) {
 		return it->second;
 	} else {
-		return rhs.distances.at(lhs.name);
+		return rhs.distances.at(lhs.id);
 	}
 }
 
-Bus Bus::ParseFrom(const Json::Dict& attrs) {
+Bus Bus::ParseFrom(const Json::Dict& attrs, const NameTable& stop_names,
+		NameTable& bus_names) {
 	// parse a bus (bus number, its stops and route type from the json "dictionary")
-	return Bus { .name = attrs.at("name").AsString(), .stops = ParseStops(
-			attrs.at("stops").AsArray(), attrs.at("is_roundtrip").AsBool()), };
+	return Bus { .id = bus_names.Intern(attrs.at("name").AsString()), .stops =
+			ParseStops(attrs.at("stops").AsArray(),
+					attrs.at("is_roundtrip").AsBool(), stop_names), };
 }
 
-vector<InputQuery> ReadBusOrStopInfo(const vector<Json::Node>& nodes) {
-	// parse a bus or a stop from the json nodes (using variant type here)
-	vector<InputQuery> result;
-	result.reserve(nodes.size());
+BaseData ReadBusOrStopInfo(const Json::Array& nodes) {
+	// parse buses and stops from the json nodes, interning their names
+	BaseData data;
+
+	// the stop names are interned first, so that the buses and the road
+	// distances can refer to stops declared after them
+	for (const Json::Node& node : nodes) {
+		const auto& node_dict = node.AsMap();
+		if (node_dict.at("type").AsString() == "Stop") {
+			data.stop_names.Intern(node_dict.at("name").AsString());
+		}
+	}
+	data.stops.resize(data.stop_names.GetSize());
 
 	for (const Json::Node& node : nodes) {
 		const auto& node_dict = node.AsMap();
 		if (node_dict.at("type").AsString() == "Bus") {
-			result.push_back(Bus::ParseFrom(node_dict));
+			Bus bus = Bus::ParseFrom(node_dict, data.stop_names,
+					data.bus_names);
+			if (bus.id == data.buses.size()) {
+				data.buses.push_back(move(bus));
+			} else {
+				data.buses[bus.id] = move(bus);  // redeclared
+			}
 		} else {
-			result.push_back(Stop::ParseFrom(node_dict));
+			Stop stop = Stop::ParseFrom(node_dict, data.stop_names);
+			data.stops[stop.id] = move(stop);
 		}
 	}
 
-	return result;
+	return data;
 }
 
 }
 
+namespace Updates {
+
+namespace {
+AddStop ParseAddStop(const Json::Dict& attrs) {
+	AddStop update = { .name = string(attrs.at("name").AsString()), .position = {
+			.latitude = attrs.at("latitude").AsDouble(), .longitude = attrs.at(
+					"longitude").AsDouble(), } };
+	if (attrs.count("road_distances") > 0) {
+		for (const auto& [stop_name, distance] : attrs.at("road_distances").AsMap()) {
+			update.distances.emplace_back(string(stop_name), distance.AsInt());
+		}
+	}
+	return update;
+}
+
+AddBus ParseAddBus(const Json::Dict& attrs) {
+	AddBus update = { .name = string(attrs.at("name").AsString()) };
+	const auto& stop_nodes = attrs.at("stops").AsArray();
+	update.stops.reserve(stop_nodes.size() * 2);
+	for (const Json::Node& stop_node : stop_nodes) {
+		update.stops.emplace_back(stop_node.AsString());
+	}
+	CompleteRoute(update.stops, attrs.at("is_roundtrip").AsBool());
+	return update;
+}
+}
+
+vector<Update> ReadUpdates(const Json::Array& nodes) {
+	vector<Update> updates;
+	updates.reserve(nodes.size());
+	for (const Json::Node& node : nodes) {
+		const auto& node_dict = node.AsMap();
+		const string_view type = node_dict.at("type").AsString();
+		if (type == "Stop") {
+			updates.push_back(ParseAddStop(node_dict));
+		} else if (type == "Bus") {
+			updates.push_back(ParseAddBus(node_dict));
+		} else if (type == "RemoveBus") {
+			updates.push_back(RemoveBus { string(node_dict.at("name").AsString()) });
+		} else if (type == "RoadDistance") {
+			updates.push_back(SetRoadDistance { .from = string(
+					node_dict.at("from").AsString()), .to = string(
+					node_dict.at("to").AsString()), .distance =
+					node_dict.at("distance").AsInt() });
+		} else {
+			throw invalid_argument("unknown update type: " + string(type));
+		}
+	}
+	return updates;
+}
+
+}
+
+namespace Settings {
+size_t ReadCount(const Json::Dict& settings, string_view key,
+		size_t default_value) {
+	const auto it = settings.find(key);
+	if (it == settings.end()) {
+		return default_value;
+	}
+	const int value = it->second.AsInt();
+	if (value < 0) {
+		throw invalid_argument("negative " + string(key));
+	}
+	return value;
+}
+}
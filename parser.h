@@ -12,42 +12,91 @@
 
 #include "json_lib.h"
 #include "distance_utils.h"
+#include "name_table.h"
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace BusOrStopInfo {
+// stops and buses are referred to by their ids in the name tables
+using StopId = NameId;
+using BusId = NameId;
+
 struct Stop {
-	std::string name;
+	StopId id;
 	Earth::Point position;
-	std::unordered_map<std::string, int> distances;
+	std::unordered_map<StopId, int> distances;
 
-	static Stop ParseFrom(const Json::Dict& attrs);
+	static Stop ParseFrom(const Json::Dict& attrs, const NameTable& stop_names);
 };
 
 int ComputeStopsDistance(const Stop& lhs, const Stop& rhs);
 
-std::vector<std::string> ParseStops(const std::vector<Json::Node>& stop_nodes,
-		bool is_roundtrip);
+std::vector<StopId> ParseStops(const Json::Array& stop_nodes,
+		bool is_roundtrip, const NameTable& stop_names);
 
 struct Bus {
+	BusId id;
+	std::vector<StopId> stops;
+
+	static Bus ParseFrom(const Json::Dict& attrs, const NameTable& stop_names,
+			NameTable& bus_names);
+};
+
+// the stops and buses of base requests, stored by their ids
+struct BaseData {
+	NameTable stop_names;
+	NameTable bus_names;
+	std::vector<Stop> stops;
+	std::vector<Bus> buses;
+};
+
+BaseData ReadBusOrStopInfo(const Json::Array& nodes);
+}
+
+// changes of the network applied once it has been built or loaded;
+// stops and buses are referred to by name, as they may be new
+namespace Updates {
+// a new stop, declared as in base requests
+struct AddStop {
 	std::string name;
-	std::vector<std::string> stops;
+	Earth::Point position;
+	std::vector<std::pair<std::string, int>> distances;
+};
+
+// a new bus, or a new route of an existing one
+struct AddBus {
+	std::string name;
+	std::vector<std::string> stops;  // the whole route, back way included
+};
 
-	static Bus ParseFrom(const Json::Dict& attrs);
+struct RemoveBus {
+	std::string name;
 };
 
-using InputQuery = std::variant<Stop, Bus>;
+// the road distance from one stop to another, also used the other way round
+// unless that one has a distance of its own
+struct SetRoadDistance {
+	std::string from;
+	std::string to;
+	int distance;
+};
 
-std::vector<InputQuery> ReadBusOrStopInfo(const std::vector<Json::Node>& nodes);
+using Update = std::variant<AddStop, AddBus, RemoveBus, SetRoadDistance>;
 
-template<typename Object>
-using Dict = std::unordered_map<std::string, const Object*>;
+std::vector<Update> ReadUpdates(const Json::Array& nodes);
+}
 
-using StopsDict = Dict<Stop>;
-using BusesDict = Dict<Bus>;
+// the values of routing_settings and execution_settings
+namespace Settings {
+// a count or a size: the value of the key if given, the default otherwise;
+// throws std::invalid_argument if the value is negative
+size_t ReadCount(const Json::Dict& settings, std::string_view key,
+		size_t default_value);
 }
 
 #endif /* PARSER_H_ */
@@ -0,0 +1,118 @@
+/*
+ * perf_stats.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "perf_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+constexpr array<string_view, PerfStats::PHASE_COUNT> PHASE_NAMES = {
+		"graph_fill", "parse", "register_build", "response_render",
+		"route_warm_up", "router_precompute", "snapshot_load", "updates" };
+
+constexpr array<string_view, PerfStats::REQUEST_TYPE_COUNT> REQUEST_TYPE_NAMES =
+		{ "Bus", "NearestStops", "Route", "RouteMatrix", "Stats", "Stop" };
+
+double ConvertToMicroseconds(uint64_t nanoseconds) {
+	return nanoseconds / 1e3;
+}
+}
+
+void LatencyHistogram::Record(chrono::nanoseconds latency) {
+	const uint64_t nanoseconds = max<int64_t>(latency.count(), 0);
+	size_t bucket = 0;
+	while (bucket + 1 < BUCKET_COUNT && (nanoseconds >> (bucket + 1)) != 0) {
+		++bucket;
+	}
+	bucket_counts_[bucket].fetch_add(1, memory_order_relaxed);
+	total_ns_.fetch_add(nanoseconds, memory_order_relaxed);
+	uint64_t max_ns = max_ns_.load(memory_order_relaxed);
+	while (max_ns < nanoseconds
+			&& !max_ns_.compare_exchange_weak(max_ns, nanoseconds,
+					memory_order_relaxed)) {
+	}
+}
+
+void LatencyHistogram::Write(Json::Writer& writer) const {
+	// the counters are read one by one, a histogram being recorded to
+	// concurrently may be slightly inconsistent
+	array<uint64_t, BUCKET_COUNT> bucket_counts;
+	uint64_t count = 0;
+	for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+		bucket_counts[bucket] = bucket_counts_[bucket].load(memory_order_relaxed);
+		count += bucket_counts[bucket];
+	}
+	const uint64_t max_ns = max_ns_.load(memory_order_relaxed);
+	auto get_upper_bound_ns = [max_ns](size_t bucket) {
+		return bucket + 1 < BUCKET_COUNT ?
+				min(uint64_t(1) << (bucket + 1), max_ns) : max_ns;
+	};
+
+	writer.BeginDict().Key("buckets").BeginArray();
+	for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+		if (bucket_counts[bucket] > 0) {
+			writer.BeginArray()
+				.Double(ConvertToMicroseconds(get_upper_bound_ns(bucket)))
+				.Int(static_cast<int64_t>(bucket_counts[bucket]))
+				.EndArray();
+		}
+	}
+	writer.EndArray().Key("count").Int(static_cast<int64_t>(count));
+	if (count == 0) {
+		writer.EndDict();
+		return;
+	}
+
+	auto get_percentile_ns = [&](double share) {
+		const uint64_t rank = max<uint64_t>(ceil(share * count), 1);
+		uint64_t seen_count = 0;
+		for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+			seen_count += bucket_counts[bucket];
+			if (seen_count >= rank) {
+				return get_upper_bound_ns(bucket);
+			}
+		}
+		return max_ns;
+	};
+	writer.Key("max_us").Double(ConvertToMicroseconds(max_ns))
+		.Key("mean_us").Double(
+			ConvertToMicroseconds(total_ns_.load(memory_order_relaxed)) / count)
+		.Key("p50_us").Double(ConvertToMicroseconds(get_percentile_ns(0.5)))
+		.Key("p90_us").Double(ConvertToMicroseconds(get_percentile_ns(0.9)))
+		.Key("p99_us").Double(ConvertToMicroseconds(get_percentile_ns(0.99)))
+		.EndDict();
+}
+
+void PerfStats::RecordPhase(Phase phase, chrono::nanoseconds duration) {
+	auto& phase_duration = phase_durations_[static_cast<size_t>(phase)];
+	phase_duration = phase_duration.value_or(chrono::nanoseconds(0)) + duration;
+}
+
+void PerfStats::WritePhases(Json::Writer& writer) const {
+	writer.BeginDict();
+	for (size_t phase_idx = 0; phase_idx < PHASE_COUNT; ++phase_idx) {
+		if (const auto& duration = phase_durations_[phase_idx]) {
+			writer.Key(string(PHASE_NAMES[phase_idx]) + "_ms").Double(
+					chrono::duration<double, milli>(*duration).count());
+		}
+	}
+	writer.EndDict();
+}
+
+void PerfStats::WriteRequestLatencies(Json::Writer& writer) const {
+	writer.BeginDict();
+	for (size_t type_idx = 0; type_idx < REQUEST_TYPE_COUNT; ++type_idx) {
+		writer.Key(REQUEST_TYPE_NAMES[type_idx]);
+		request_latencies_[type_idx].Write(writer);
+	}
+	writer.EndDict();
+}
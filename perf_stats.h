@@ -0,0 +1,106 @@
+/*
+ * perf_stats.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef PERF_STATS_H_
+#define PERF_STATS_H_
+
+#pragma once
+
+#include "json_lib.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+// latencies counted in power-of-two buckets of nanoseconds: bucket k holds
+// [2^k, 2^(k+1)) ns, the last one everything longer; recording takes a few
+// relaxed atomic increments, so it can be done from any thread without locks
+class LatencyHistogram {
+public:
+	static constexpr size_t BUCKET_COUNT = 40;
+
+	void Record(std::chrono::nanoseconds latency);
+
+	// count, mean, max and percentiles in microseconds, and the non-empty buckets
+	// as [upper bound in microseconds, count]; a percentile is the upper bound of
+	// its bucket, so it overestimates by less than 2x
+	void Write(Json::Writer& writer) const;
+
+private:
+	std::array<std::atomic<uint64_t>, BUCKET_COUNT> bucket_counts_ { };
+	std::atomic<uint64_t> total_ns_ = 0;
+	std::atomic<uint64_t> max_ns_ = 0;
+};
+
+// instrumentation of a run: the durations of the phases of building the register
+// and the latencies of the stat requests by type
+class PerfStats {
+public:
+	// in the order of their names, which is the order they are written in
+	enum class Phase {
+		GraphFill,
+		Parse,
+		RegisterBuild,
+		ResponseRender,
+		RouteWarmUp,
+		RouterPrecompute,
+		SnapshotLoad,
+		Updates,
+	};
+	static constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::Updates)
+			+ 1;
+
+	// in the order of their names, as well
+	enum class RequestType {
+		Bus,
+		NearestStops,
+		Route,
+		RouteMatrix,
+		Stats,
+		Stop,
+	};
+	static constexpr size_t REQUEST_TYPE_COUNT =
+			static_cast<size_t>(RequestType::Stop) + 1;
+
+	// a phase run several times (e.g. updates) adds up; phases are only recorded
+	// while no requests are answered
+	void RecordPhase(Phase phase, std::chrono::nanoseconds duration);
+
+	// thread-safe
+	void RecordRequest(RequestType type, std::chrono::nanoseconds latency) {
+		request_latencies_[static_cast<size_t>(type)].Record(latency);
+	}
+
+	// a dict of the recorded phases, "<phase>_ms": duration
+	void WritePhases(Json::Writer& writer) const;
+
+	// a dict of the histograms by request type
+	void WriteRequestLatencies(Json::Writer& writer) const;
+
+private:
+	std::array<std::optional<std::chrono::nanoseconds>, PHASE_COUNT> phase_durations_;
+	std::array<LatencyHistogram, REQUEST_TYPE_COUNT> request_latencies_;
+};
+
+// the time elapsed since the construction
+class Stopwatch {
+public:
+	Stopwatch() :
+			start_(std::chrono::steady_clock::now()) {
+	}
+
+	std::chrono::nanoseconds GetElapsed() const {
+		return std::chrono::steady_clock::now() - start_;
+	}
+
+private:
+	std::chrono::steady_clock::time_point start_;
+};
+
+#endif /* PERF_STATS_H_ */
@@ -8,102 +8,311 @@
 #include "queries.h"
 #include "transport_router.h"
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 
 using namespace std;
 
 namespace Queries {
 
-Json::Dict Stop::Process(const TransportRegister& db) const {
-	const auto* stop = db.GetStop(name);
-	Json::Dict dict;
+// the keys of a response are written in sorted order, as a Json::Dict would print them
+
+void WriteNotFound(int request_id, Json::Writer& writer) {
+	writer.BeginDict()
+		.Key("error_message").String("not found")
+		.Key("request_id").Int(request_id)
+		.EndDict();
+}
+
+// the responses to Stop and Bus from the register itself, not the rendered ones
+void WriteStopResponse(const TransportRegister& db, string_view name,
+		int request_id, Json::Writer& writer) {
+	const auto stop = db.GetStop(name);
 	if (!stop) {
-		dict["error_message"] = Json::Node("not found"s);
-	} else {
-		vector<Json::Node> bus_nodes;
-		bus_nodes.reserve(stop->bus_names.size());
-		for (const auto& bus_name : stop->bus_names) {
-			bus_nodes.emplace_back(bus_name);
-		}
-		dict["buses"] = Json::Node(move(bus_nodes));
+		WriteNotFound(request_id, writer);
+		return;
+	}
+	writer.BeginDict().Key("buses").BeginArray();
+	for (const BusOrStopInfo::BusId bus_id : stop->bus_ids) {
+		writer.String(db.GetBusName(bus_id));
 	}
-	return dict;
+	writer.EndArray()
+		.Key("request_id").Int(request_id)
+		.EndDict();
 }
 
-Json::Dict Bus::Process(const TransportRegister& db) const {
+void WriteBusResponse(const TransportRegister& db, string_view name,
+		int request_id, Json::Writer& writer) {
 	const auto* bus = db.GetBus(name);
-	Json::Dict dict;
 	if (!bus) {
-		dict["error_message"] = Json::Node("not found"s);
-	} else {
-		dict = {
-			{	"stop_count", Json::Node(static_cast<int>(bus->stop_count))},
-			{	"unique_stop_count", Json::Node(static_cast<int>(bus->unique_stop_count))},
-			{	"route_length", Json::Node(bus->road_route_length)},
-			{	"curvature", Json::Node(bus->road_route_length / bus->geo_route_length)},
-		};
+		WriteNotFound(request_id, writer);
+		return;
+	}
+	writer.BeginDict()
+		.Key("curvature").Double(bus->road_route_length / bus->geo_route_length)
+		.Key("request_id").Int(request_id)
+		.Key("route_length").Double(bus->road_route_length)
+		.Key("stop_count").Int(static_cast<int>(bus->stop_count))
+		.Key("unique_stop_count").Int(static_cast<int>(bus->unique_stop_count))
+		.EndDict();
+}
+
+void Stop::Process(const TransportRegister& db, int request_id,
+		Json::Writer& writer) const {
+	if (!db.WriteRenderedStopResponse(name, request_id, writer)) {
+		WriteStopResponse(db, name, request_id, writer);
 	}
-	return dict;
 }
 
-struct RouteItemResponseBuilder {
-	Json::Dict operator()(
-			const TransportRouter::RouteInfo::BusItem& bus_item) const {
-		return Json::Dict { { "type", Json::Node("Bus"s) }, { "bus", Json::Node(
-				bus_item.bus_name) }, { "time", Json::Node(bus_item.time) },
-				{ "span_count", Json::Node(
-						static_cast<int>(bus_item.span_count)) } };
+void Bus::Process(const TransportRegister& db, int request_id,
+		Json::Writer& writer) const {
+	if (!db.WriteRenderedBusResponse(name, request_id, writer)) {
+		WriteBusResponse(db, name, request_id, writer);
 	}
-	Json::Dict operator()(
+}
+
+struct RouteItemResponseWriter {
+	const TransportRegister& db;
+	Json::Writer& writer;
+
+	void operator()(const TransportRouter::RouteInfo::BusItem& bus_item) const {
+		writer.BeginDict()
+			.Key("bus").String(db.GetBusName(bus_item.bus_id))
+			.Key("span_count").Int(static_cast<int>(bus_item.span_count))
+			.Key("time").Double(bus_item.time)
+			.Key("type").String("Bus")
+			.EndDict();
+	}
+	void operator()(
 			const TransportRouter::RouteInfo::WaitItem& wait_item) const {
-		return Json::Dict { { "type", Json::Node("Wait"s) }, { "stop_name",
-				Json::Node(wait_item.stop_name) }, { "time", Json::Node(
-				wait_item.time) }, };
+		writer.BeginDict()
+			.Key("stop_name").String(db.GetStopName(wait_item.stop_id))
+			.Key("time").Double(wait_item.time)
+			.Key("type").String("Wait")
+			.EndDict();
 	}
 };
 
-Json::Dict Route::Process(const TransportRegister& db) const {
-	Json::Dict dict;
+void Route::Process(const TransportRegister& db, int request_id,
+		Json::Writer& writer) const {
 	const auto route = db.FindRoute(stop_from, stop_to);
 	if (!route) {
-		dict["error_message"] = Json::Node("not found"s);
-	} else {
-		dict["total_time"] = Json::Node(route->total_time);
-		vector<Json::Node> items;
-		items.reserve(route->items.size());
-		for (const auto& item : route->items) {
-			items.push_back(visit(RouteItemResponseBuilder { }, item));
+		WriteNotFound(request_id, writer);
+		return;
+	}
+	writer.BeginDict().Key("items").BeginArray();
+	for (const auto& item : route->items) {
+		visit(RouteItemResponseWriter { db, writer }, item);
+	}
+	writer.EndArray()
+		.Key("request_id").Int(request_id)
+		.Key("total_time").Double(route->total_time)
+		.EndDict();
+}
+
+void RouteMatrix::Process(const TransportRegister& db, int request_id,
+		Json::Writer& writer) const {
+	const bool has_unknown_stop = any_of(begin(stops_from), end(stops_from),
+			[&db](const string& name) {
+				return !db.GetStop(name);
+			}) || any_of(begin(stops_to), end(stops_to), [&db](const string& name) {
+				return !db.GetStop(name);
+			});
+	if (has_unknown_stop) {
+		WriteNotFound(request_id, writer);
+		return;
+	}
+
+	// rows by the stops from, a missing route is null
+	const auto total_times = db.ComputeRouteTimes(stops_from, stops_to);
+	writer.BeginDict();
+	if (with_items) {
+		// the batch yields no routes, so each pair with a route is routed again
+		writer.Key("items").BeginArray();
+		for (size_t from_idx = 0; from_idx < stops_from.size(); ++from_idx) {
+			writer.BeginArray();
+			for (size_t to_idx = 0; to_idx < stops_to.size(); ++to_idx) {
+				if (!total_times[from_idx * stops_to.size() + to_idx]) {
+					writer.Null();
+					continue;
+				}
+				const auto route = db.FindRoute(stops_from[from_idx],
+						stops_to[to_idx]);
+				writer.BeginArray();
+				for (const auto& item : route->items) {
+					visit(RouteItemResponseWriter { db, writer }, item);
+				}
+				writer.EndArray();
+			}
+			writer.EndArray();
+		}
+		writer.EndArray();
+	}
+	writer.Key("request_id").Int(request_id).Key("total_times").BeginArray();
+	for (size_t from_idx = 0; from_idx < stops_from.size(); ++from_idx) {
+		writer.BeginArray();
+		for (size_t to_idx = 0; to_idx < stops_to.size(); ++to_idx) {
+			if (const auto total_time = total_times[from_idx * stops_to.size()
+					+ to_idx]) {
+				writer.Double(*total_time);
+			} else {
+				writer.Null();
+			}
 		}
+		writer.EndArray();
+	}
+	writer.EndArray().EndDict();
+}
+
+vector<string> ReadStopNames(const Json::Array& nodes) {
+	vector<string> stop_names;
+	stop_names.reserve(nodes.size());
+	for (const Json::Node& node : nodes) {
+		stop_names.emplace_back(node.AsString());
+	}
+	return stop_names;
+}
 
-		dict["items"] = move(items);
+void NearestStops::Process(const TransportRegister& db, int request_id,
+		Json::Writer& writer) const {
+	const auto stops = db.FindNearestStops(point,
+			count.value_or(numeric_limits<size_t>::max()),
+			radius.value_or(numeric_limits<double>::infinity()));
+	writer.BeginDict()
+		.Key("request_id").Int(request_id)
+		.Key("stops").BeginArray();
+	for (const auto& stop : stops) {
+		writer.BeginDict()
+			.Key("distance").Double(stop.distance)
+			.Key("name").String(db.GetStopName(stop.id))
+			.EndDict();
+	}
+	writer.EndArray().EndDict();
+}
+
+NearestStops ReadNearestStops(const Json::Dict& attrs) {
+	NearestStops request { .point = { .latitude =
+			attrs.at("latitude").AsDouble(), .longitude =
+			attrs.at("longitude").AsDouble() } };
+	if (attrs.count("k") > 0) {
+		const int count = attrs.at("k").AsInt();
+		if (count < 0) {
+			throw invalid_argument("negative k of NearestStops");
+		}
+		request.count = count;
+	}
+	if (attrs.count("radius") > 0) {
+		request.radius = attrs.at("radius").AsDouble();
+		if (*request.radius < 0) {
+			throw invalid_argument("negative radius of NearestStops");
+		}
 	}
+	if (!request.count && !request.radius) {
+		throw invalid_argument("NearestStops needs k or radius");
+	}
+	return request;
+}
 
-	return dict;
+void Stats::Process(const TransportRegister& db, int request_id,
+		Json::Writer& writer) const {
+	writer.BeginDict();
+	db.WriteStats(writer);
+	writer.Key("request_id").Int(request_id).EndDict();
 }
 
-variant<Stop, Bus, Route> Read(const Json::Dict& attrs) {
-	const string& type = attrs.at("type").AsString();
+variant<Stop, Bus, Route, RouteMatrix, NearestStops, Stats> Read(
+		const Json::Dict& attrs) {
+	const string_view type = attrs.at("type").AsString();
 	if (type == "Bus") {
-		return Bus { attrs.at("name").AsString() };
+		return Bus { string(attrs.at("name").AsString()) };
 	} else if (type == "Stop") {
-		return Stop { attrs.at("name").AsString() };
+		return Stop { string(attrs.at("name").AsString()) };
+	} else if (type == "Stats") {
+		return Stats { };
+	} else if (type == "NearestStops") {
+		return ReadNearestStops(attrs);
+	} else if (type == "RouteMatrix") {
+		return RouteMatrix { ReadStopNames(attrs.at("from").AsArray()),
+			ReadStopNames(attrs.at("to").AsArray()), attrs.count("with_items") > 0
+					&& attrs.at("with_items").AsBool() };
 	} else {
-		return Route { attrs.at("from").AsString(), attrs.at("to").AsString() };
+		return Route { string(attrs.at("from").AsString()),
+			string(attrs.at("to").AsString()) };
 	}
 }
 
-vector<Json::Node> ProcessAll(const TransportRegister& db,
-		const vector<Json::Node>& requests) {
-	vector<Json::Node> responses;
-	responses.reserve(requests.size());
+void ProcessOne(const TransportRegister& db, const Json::Node& request_node,
+		Json::Writer& writer) {
+	const Stopwatch stopwatch;
+	const int request_id = request_node.AsMap().at("id").AsInt();
+	visit([&db, request_id, &writer, &stopwatch](const auto& request) {
+		request.Process(db, request_id, writer);
+		db.GetPerfStats().RecordRequest(request.TYPE, stopwatch.GetElapsed());
+	}, Queries::Read(request_node.AsMap()));
+}
+
+void RenderResponses(TransportRegister& db, ThreadPool& thread_pool) {
+	// written as Process would, so the responses are the same to the byte
+	const Stopwatch stopwatch;
+	RenderedResponses stop_responses(db.GetStopCount(), thread_pool,
+			[&db](size_t stop_id, Json::Writer& writer) {
+				WriteStopResponse(db, db.GetStopName(stop_id), 0, writer);
+			});
+	RenderedResponses bus_responses(db.GetBusCount(), thread_pool,
+			[&db](size_t bus_id, Json::Writer& writer) {
+				WriteBusResponse(db, db.GetBusName(bus_id), 0, writer);
+			});
+	db.SetRenderedResponses(move(stop_responses), move(bus_responses));
+	db.GetPerfStats().RecordPhase(PerfStats::Phase::ResponseRender,
+			stopwatch.GetElapsed());
+}
+
+void ProcessAll(const TransportRegister& db,
+		const Json::Array& requests, ostream& output) {
+	Json::Writer writer(output);
+	writer.BeginArray();
 	for (const Json::Node& request_node : requests) {
-		Json::Dict dict = visit([&db](const auto& request) {
-			return request.Process(db);
-		}, Queries::Read(request_node.AsMap()));
-		dict["request_id"] = Json::Node(request_node.AsMap().at("id").AsInt());
-		responses.push_back(Json::Node(dict));
+		ProcessOne(db, request_node, writer);
+		writer.Flush();
+	}
+	writer.EndArray().Flush(true);
+}
+
+void ProcessAll(const TransportRegister& db,
+		const Json::Array& requests, ThreadPool& thread_pool,
+		ostream& output) {
+	// the requests are split into blocks, each rendered by a writer of its own;
+	// a wave of blocks is answered concurrently and then spliced in order,
+	// so only one wave of responses is held in memory at a time
+	constexpr size_t REQUESTS_PER_BLOCK = 64;
+	const size_t block_count = (requests.size() + REQUESTS_PER_BLOCK - 1)
+			/ REQUESTS_PER_BLOCK;
+	vector<Json::Writer> block_writers(thread_pool.GetThreadCount() * 4);
+
+	Json::Writer writer(output);
+	writer.BeginArray();
+	for (size_t wave_begin = 0; wave_begin < block_count;
+			wave_begin += block_writers.size()) {
+		const size_t wave_size = min(block_writers.size(),
+				block_count - wave_begin);
+		thread_pool.ParallelFor(wave_size,
+				[&db, &requests, &block_writers, wave_begin](size_t block_idx) {
+					Json::Writer& block_writer = block_writers[block_idx];
+					block_writer.Clear();
+					const size_t begin = (wave_begin + block_idx) * REQUESTS_PER_BLOCK;
+					const size_t end = min(begin + REQUESTS_PER_BLOCK, requests.size());
+					for (size_t request_idx = begin; request_idx < end; ++request_idx) {
+						ProcessOne(db, requests[request_idx], block_writer);
+					}
+				});
+		for (size_t block_idx = 0; block_idx < wave_size; ++block_idx) {
+			writer.Raw(block_writers[block_idx].GetText());
+			writer.Flush();
+		}
 	}
-	return responses;
+	writer.EndArray().Flush(true);
 }
 
 }
@@ -11,35 +11,107 @@
 #pragma once
 
 #include "json_lib.h"
+#include "perf_stats.h"
+#include "thread_pool.h"
 #include "transport_register.h"
 
+#include <iostream>
+#include <optional>
 #include <string>
 #include <variant>
+#include <vector>
 
+// every request records its latency under its TYPE
 namespace Queries {
 struct Stop {
+	static constexpr PerfStats::RequestType TYPE = PerfStats::RequestType::Stop;
+
 	std::string name;
 
-	Json::Dict Process(const TransportRegister& db) const;
+	void Process(const TransportRegister& db, int request_id,
+			Json::Writer& writer) const;
 };
 
 struct Bus {
+	static constexpr PerfStats::RequestType TYPE = PerfStats::RequestType::Bus;
+
 	std::string name;
 
-	Json::Dict Process(const TransportRegister& db) const;
+	void Process(const TransportRegister& db, int request_id,
+			Json::Writer& writer) const;
 };
 
 struct Route {
+	static constexpr PerfStats::RequestType TYPE = PerfStats::RequestType::Route;
+
 	std::string stop_from;
 	std::string stop_to;
 
-	Json::Dict Process(const TransportRegister& db) const;
+	void Process(const TransportRegister& db, int request_id,
+			Json::Writer& writer) const;
 };
 
-std::variant<Stop, Bus, Route> Read(const Json::Dict& attrs);
+// the total times from every stop of one list to every stop of the other,
+// computed in one batch; the items of the routes are only listed on demand.
+// With items, the batch only tells which pairs have a route: the items of each
+// of those are found by routing the pair on its own, as Route does (through
+// the route cache), so the request costs up to one search per pair
+struct RouteMatrix {
+	static constexpr PerfStats::RequestType TYPE =
+			PerfStats::RequestType::RouteMatrix;
+
+	std::vector<std::string> stops_from;
+	std::vector<std::string> stops_to;
+	bool with_items = false;
+
+	void Process(const TransportRegister& db, int request_id,
+			Json::Writer& writer) const;
+};
+
+// the stops nearest to a point: the count nearest ones, those within the radius
+// (in meters), or the count nearest ones within the radius
+struct NearestStops {
+	static constexpr PerfStats::RequestType TYPE =
+			PerfStats::RequestType::NearestStops;
+
+	Earth::Point point;
+	std::optional<size_t> count;
+	std::optional<double> radius;
+
+	void Process(const TransportRegister& db, int request_id,
+			Json::Writer& writer) const;
+};
+
+// the performance counters, phase durations and request latencies of the run
+// so far; with concurrent requests it may or may not count the requests around it
+struct Stats {
+	static constexpr PerfStats::RequestType TYPE = PerfStats::RequestType::Stats;
+
+	void Process(const TransportRegister& db, int request_id,
+			Json::Writer& writer) const;
+};
+
+// throws std::invalid_argument for a NearestStops request with neither
+// a count nor a radius, or with a negative one
+std::variant<Stop, Bus, Route, RouteMatrix, NearestStops, Stats> Read(
+		const Json::Dict& attrs);
+
+// renders the responses to the Stop and Bus requests for every stop and bus
+// ahead, so that answering them is copying; they are valid until an update
+void RenderResponses(TransportRegister& db, ThreadPool& thread_pool);
+
+// answers a request node of stat_requests, recording its latency
+void ProcessOne(const TransportRegister& db, const Json::Node& request_node,
+		Json::Writer& writer);
+
+// the responses are written to the output as a json array, as they are ready
+void ProcessAll(const TransportRegister& db,
+		const Json::Array& requests, std::ostream& output);
 
-std::vector<Json::Node> ProcessAll(const TransportRegister& db,
-		const std::vector<Json::Node>& requests);
+// the requests are answered concurrently, the responses keep the order of the requests
+void ProcessAll(const TransportRegister& db,
+		const Json::Array& requests, ThreadPool& thread_pool,
+		std::ostream& output);
 }
 
 #endif /* QUERIES_H_ */
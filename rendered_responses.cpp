@@ -0,0 +1,64 @@
+/*
+ * rendered_responses.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "rendered_responses.h"
+
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+// how a response rendered with the request id 0 ends: the key is looked for from
+// the end, since no string of the response can follow it
+constexpr string_view REQUEST_ID_KEY = "\"request_id\": ";
+constexpr string_view RENDERED_REQUEST_ID = "0";
+}
+
+RenderedResponses::RenderedResponses(size_t count, ThreadPool& thread_pool,
+		const function<void(size_t id, Json::Writer& writer)>& render) :
+		offsets_(count + 1, 0), split_offsets_(count, 0) {
+	// every response is rendered into a buffer of its own, then all are packed
+	vector<string> texts(count);
+	thread_pool.ParallelFor(count, [&](size_t id) {
+		Json::Writer writer;
+		render(id, writer);
+		const string_view text = writer.GetText();
+		const size_t key_pos = text.rfind(REQUEST_ID_KEY);
+		if (key_pos == string_view::npos
+				|| text.substr(key_pos + REQUEST_ID_KEY.size(),
+						RENDERED_REQUEST_ID.size()) != RENDERED_REQUEST_ID) {
+			throw logic_error("a rendered response has no request id");
+		}
+		split_offsets_[id] = key_pos + REQUEST_ID_KEY.size();
+		texts[id] = string(text.substr(0, split_offsets_[id]))
+				+ string(text.substr(split_offsets_[id] + RENDERED_REQUEST_ID.size()));
+	});
+
+	size_t text_size = 0;
+	for (const auto& text : texts) {
+		text_size += text.size();
+	}
+	if (text_size > numeric_limits<uint32_t>::max()) {
+		throw length_error("rendered responses do not fit 4 GiB");
+	}
+	text_.reserve(text_size);
+	for (size_t id = 0; id < count; ++id) {
+		split_offsets_[id] += text_.size();
+		text_ += texts[id];
+		offsets_[id + 1] = text_.size();
+	}
+}
+
+void RenderedResponses::Write(size_t id, int request_id,
+		Json::Writer& writer) const {
+	const string_view text = text_;
+	writer.Raw(text.substr(offsets_[id], split_offsets_[id] - offsets_[id]),
+			request_id,
+			text.substr(split_offsets_[id], offsets_[id + 1] - split_offsets_[id]));
+}
@@ -0,0 +1,46 @@
+/*
+ * rendered_responses.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef RENDERED_RESPONSES_H_
+#define RENDERED_RESPONSES_H_
+
+#pragma once
+
+#include "json_lib.h"
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// responses rendered ahead into one shared buffer, by a dense id of what they
+// answer (e.g. a stop id); every response is kept split where its request id
+// goes, so writing it is two copies around the id
+class RenderedResponses {
+public:
+	// render writes the response for an id with the request id 0, the response
+	// has to have a "request_id" key after all its strings (std::logic_error
+	// otherwise); the responses are rendered concurrently by the threads of the pool
+	RenderedResponses(size_t count, ThreadPool& thread_pool,
+			const std::function<void(size_t id, Json::Writer& writer)>& render);
+
+	size_t GetSize() const {
+		return split_offsets_.size();
+	}
+
+	void Write(size_t id, int request_id, Json::Writer& writer) const;
+
+private:
+	std::string text_;
+	// response id spans [offsets_[id], offsets_[id + 1]), its request id goes
+	// at split_offsets_[id]
+	std::vector<uint32_t> offsets_;
+	std::vector<uint32_t> split_offsets_;
+};
+
+#endif /* RENDERED_RESPONSES_H_ */
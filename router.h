@@ -10,148 +10,509 @@
 
 #pragma once
 
+#include "csr_graph.h"
 #include "graph.h"
+#include "router_base.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
-#include <unordered_map>
+#include <queue>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace Graph {
 
+// encodings of the route weights in the tables of the all-pairs router: Stored is
+// what a cell holds, NO_ROUTE marks a missing route, and Add never wraps around
+// but saturates at NO_ROUTE; all the encodings are monotonic, so the tables stay
+// consistent trees of routes, only the choice between nearly equal routes can change
+
+// the weights as they are
 template<typename Weight>
-class Router {
+struct ExactWeights {
+	static_assert(std::numeric_limits<Weight>::has_infinity,
+			"a missing route is encoded with an infinite weight");
+	using Stored = Weight;
+	static constexpr Stored NO_ROUTE = std::numeric_limits<Weight>::infinity();
+
+	static Stored Encode(Weight weight) {
+		return weight;
+	}
+	static Weight Decode(Stored weight) {
+		return weight;
+	}
+	static Stored Add(Stored lhs, Stored rhs) {
+		return lhs + rhs;
+	}
+};
+
+// rounded to float: 24 significant bits, half the memory of double
+template<typename Weight>
+struct FloatWeights {
+	using Stored = float;
+	static constexpr Stored NO_ROUTE = std::numeric_limits<float>::infinity();
+
+	static Stored Encode(Weight weight) {
+		return static_cast<float>(weight);
+	}
+	static Weight Decode(Stored weight) {
+		return weight;
+	}
+	static Stored Add(Stored lhs, Stored rhs) {
+		return lhs + rhs;
+	}
+};
+
+// rounded to the nearest 1/SCALE in 32-bit fixed point; the weights up to
+// about 4 million (UINT32_MAX / SCALE) are kept, the larger ones saturate
+template<typename Weight>
+struct FixedPointWeights {
+	using Stored = uint32_t;
+	static constexpr Stored NO_ROUTE = std::numeric_limits<uint32_t>::max();
+	static constexpr Weight SCALE = 1024;
+
+	static Stored Encode(Weight weight) {
+		if (!(weight < static_cast<Weight>(NO_ROUTE - 1) / SCALE)) {
+			return weight == std::numeric_limits<Weight>::infinity() ?
+					NO_ROUTE : NO_ROUTE - 1;
+		}
+		return static_cast<Stored>(std::llround(weight * SCALE));
+	}
+	static Weight Decode(Stored weight) {
+		return weight == NO_ROUTE ?
+				std::numeric_limits<Weight>::infinity() : weight / SCALE;
+	}
+	static Stored Add(Stored lhs, Stored rhs) {
+		// a sum which wraps around is smaller than either term
+		const Stored sum = lhs + rhs;
+		return sum < lhs ? NO_ROUTE : sum;
+	}
+};
+
+// all-pairs router: the optimal routes between every pair of vertices are
+// precomputed (Floyd-Warshall) so that a query is only a walk back along the table
+template<typename Weight, typename Encoding = ExactWeights<Weight>>
+class Router: public RouterBase<Weight> {
 private:
-	using Graph = DirectedWeightedGraph<Weight>;
+	using Graph = CsrGraph<Weight>;
+	using typename RouterBase<Weight>::ExpandedRoute;
+	using typename RouterBase<Weight>::GraphChange;
+	using TableWeight = typename Encoding::Stored;
 
 public:
-	Router(const Graph& graph);
+	// with other than one thread (0 for all hardware threads) the routes are computed
+	// by the tiled parallel algorithm
+	Router(const Graph& graph, size_t thread_count = 1);
+	// the tables are used in place inside the mapped snapshot
+	Router(const Graph& graph, Snapshot::Reader& reader);
 
-	using RouteId = uint64_t;
+	void Serialize(Snapshot::Writer& writer) const override;
 
-	struct RouteInfo {
-		RouteId id;
-		Weight weight;
-		size_t edge_count;
-	};
+	size_t GetMemoryUsage() const override;
+
+	// the weights are read right from the table rows
+	std::vector<Weight> ComputeWeightMatrix(const std::vector<VertexId>& sources,
+			const std::vector<VertexId>& targets) const override;
 
-	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
-	EdgeId GetRouteEdge(RouteId route_id, size_t edge_idx) const;
-	void RemoveRoute(RouteId route_id);
+protected:
+	std::optional<ExpandedRoute> ExpandRoute(VertexId from, VertexId to) const
+			override;
+	void UpdateRoutes(const GraphChange& change) override;
 
 private:
 	const Graph& graph_;
+	size_t vertex_count_;
 
-	struct RouteWeightEdgeData {
-		Weight weight;
-		std::optional<EdgeId> prev_edge;
-	};
-	using RoutesWeightEdgeData = std::vector<std::vector<std::optional<RouteWeightEdgeData>>>; // vector indices are vertices
+	// routes' weights and last edges are stored in two flat row-major V x V tables
+	// (structure of arrays): the route from u to v lives at index u * V + v
+	static constexpr TableWeight NO_ROUTE = Encoding::NO_ROUTE;
+	static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
 
-	using ExpandedRoute = std::vector<EdgeId>;
-	mutable RouteId next_route_id_ = 0;
-	mutable std::unordered_map<RouteId, ExpandedRoute> expanded_routes_cache_; // routes are vectors of edges
+	size_t GetCellIndex(VertexId from, VertexId to) const {
+		return from * vertex_count_ + to;
+	}
 
 	void InitializeRoutesInternalData(const Graph& graph) {
-		const size_t vertex_count = graph.GetVertexCount();
-		for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-			routes_weight_edge_data_[vertex][vertex] = RouteWeightEdgeData { 0,
-					std::nullopt };
-			for (const EdgeId edge_id : graph.GetVertexEdges(vertex)) {
-				const auto& edge = graph.GetEdge(edge_id);
-				assert(edge.weight >= 0);
-				auto& route_internal_data =
-						routes_weight_edge_data_[vertex][edge.to];
-				if (!route_internal_data
-						|| route_internal_data->weight > edge.weight) {
-					route_internal_data = RouteWeightEdgeData { edge.weight,
-							edge_id };
+		assert(graph.GetEdgeCount() < NO_EDGE);
+		for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+			route_weights_[GetCellIndex(vertex, vertex)] = 0;
+			for (const auto& arc : graph.GetOutArcs(vertex)) {
+				assert(arc.weight >= 0);
+				const size_t cell_idx = GetCellIndex(vertex, arc.to);
+				const TableWeight arc_weight = Encoding::Encode(arc.weight);
+				if (route_weights_[cell_idx] > arc_weight) {
+					route_weights_[cell_idx] = arc_weight;
+					route_prev_edges_[cell_idx] = arc.edge_id;
 				}
 			}
 		}
 	}
 
-	void RelaxRoute(VertexId vertex_from, VertexId vertex_to,
-			const RouteWeightEdgeData& route_from,
-			const RouteWeightEdgeData& route_to) {
-		auto& route_relaxing = routes_weight_edge_data_[vertex_from][vertex_to];
-		const Weight candidate_weight = route_from.weight + route_to.weight;
-		if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-			route_relaxing = {
-				candidate_weight,
-				route_to.prev_edge
-				? route_to.prev_edge
-				: route_from.prev_edge
-			};
+	// relaxes the routes from one vertex to a segment of vertices through a pivot vertex,
+	// given the route to the pivot and the pivot's row segment;
+	// the body is branchless over contiguous rows so that the loop can be vectorized,
+	// a missing route through the pivot has an infinite candidate weight and never wins
+	static void RelaxRowSegment(TableWeight weight_from, uint32_t prev_edge_from,
+			const TableWeight* weights_through, const uint32_t* prev_edges_through,
+			TableWeight* weights, uint32_t* prev_edges, size_t count) {
+		if (weight_from == NO_ROUTE) {
+			return;
+		}
+		for (size_t idx = 0; idx < count; ++idx) {
+			const TableWeight candidate_weight = Encoding::Add(weight_from,
+					weights_through[idx]);
+			const bool is_better = candidate_weight < weights[idx];
+			const uint32_t candidate_prev_edge =
+					prev_edges_through[idx] != NO_EDGE ?
+							prev_edges_through[idx] : prev_edge_from;
+			weights[idx] = is_better ? candidate_weight : weights[idx];
+			prev_edges[idx] = is_better ? candidate_prev_edge : prev_edges[idx];
 		}
 	}
 
-	void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-		for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-			if (const auto& route_from = routes_weight_edge_data_[vertex_from][vertex_through]) {
-				for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-					if (const auto& route_to = routes_weight_edge_data_[vertex_through][vertex_to]) {
-						RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-					}
-				}
-			}
+	void RelaxRoutesInternalDataThroughVertex(VertexId vertex_through) {
+		const size_t row_through = GetCellIndex(vertex_through, 0);
+		for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+			const size_t cell_idx = GetCellIndex(vertex_from, vertex_through);
+			const size_t row_from = GetCellIndex(vertex_from, 0);
+			RelaxRowSegment(route_weights_[cell_idx], route_prev_edges_[cell_idx],
+					&route_weights_[row_through], &route_prev_edges_[row_through],
+					&route_weights_[row_from], &route_prev_edges_[row_from],
+					vertex_count_);
 		}
 	}
 
-	RoutesWeightEdgeData routes_weight_edge_data_;
+	void ComputeRoutesTiled(ThreadPool& thread_pool);
+
+	void GrowTables(size_t old_vertex_count);
+	void RecomputeRow(VertexId vertex_from);
+	void InsertEdges(VertexId source, const std::vector<EdgeId>& edge_ids);
+
+	Snapshot::FlatArray<TableWeight> route_weights_;
+	Snapshot::FlatArray<uint32_t> route_prev_edges_;  // NO_EDGE for empty routes
 };
 
-template<typename Weight>
-Router<Weight>::Router(const Graph& graph) :
-		graph_(graph), routes_weight_edge_data_(graph.GetVertexCount(),
-				std::vector<std::optional<RouteWeightEdgeData>>(
-						graph.GetVertexCount())) {
+template<typename Weight, typename Encoding>
+Router<Weight, Encoding>::Router(const Graph& graph, size_t thread_count) :
+		graph_(graph), vertex_count_(graph.GetVertexCount()), route_weights_(
+				vertex_count_ * vertex_count_, NO_ROUTE), route_prev_edges_(
+				vertex_count_ * vertex_count_, NO_EDGE) {
 	// initialize the graph
 	InitializeRoutesInternalData(graph);
 
+	if (thread_count != 1) {
+		ThreadPool thread_pool(thread_count);
+		ComputeRoutesTiled(thread_pool);
+		return;
+	}
+
 	// construct optimal routes for each vertex
-	const size_t vertex_count = graph.GetVertexCount();
-	for (VertexId vertex_through = 0; vertex_through < vertex_count;
+	for (VertexId vertex_through = 0; vertex_through < vertex_count_;
 			++vertex_through) {
-		RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+		RelaxRoutesInternalDataThroughVertex(vertex_through);
 	}
 }
 
-template<typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(
-		VertexId from, VertexId to) const {
-	const auto& route_internal_data = routes_weight_edge_data_[from][to];
-	if (!route_internal_data) {
-		return std::nullopt;
+template<typename Weight, typename Encoding>
+Router<Weight, Encoding>::Router(const Graph& graph, Snapshot::Reader& reader) :
+		graph_(graph), vertex_count_(graph.GetVertexCount()), route_weights_(
+				reader.ReadFlatArray<TableWeight>()), route_prev_edges_(
+				reader.ReadFlatArray<uint32_t>()) {
+	if (route_weights_.size() != vertex_count_ * vertex_count_
+			|| route_prev_edges_.size() != vertex_count_ * vertex_count_) {
+		throw std::runtime_error("route tables do not match the graph");
 	}
-	const Weight weight = route_internal_data->weight;
-	std::vector<EdgeId> edges;
-	for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-			edge_id;
-			edge_id =
-					routes_weight_edge_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge) {
-		edges.push_back(*edge_id);
+}
+
+template<typename Weight, typename Encoding>
+void Router<Weight, Encoding>::Serialize(Snapshot::Writer& writer) const {
+	writer.WriteArray(route_weights_.data(), route_weights_.size());
+	writer.WriteArray(route_prev_edges_.data(), route_prev_edges_.size());
+}
+
+template<typename Weight, typename Encoding>
+size_t Router<Weight, Encoding>::GetMemoryUsage() const {
+	return route_weights_.size() * sizeof(TableWeight)
+			+ route_prev_edges_.size() * sizeof(uint32_t);
+}
+
+// Blocked Floyd-Warshall: the pivots are taken by blocks of TILE_SIZE vertices,
+// and for every block the diagonal tile is processed first, then the tiles of the
+// pivot rows and columns, then all the remaining tiles in parallel.
+// Unlike the textbook version, the pivot rows and columns are recorded at the very
+// step at which each pivot is taken, so every cell sees exactly the same sequence of
+// candidates as in the plain triple loop: weights and last edges come out bit-identical.
+template<typename Weight, typename Encoding>
+void Router<Weight, Encoding>::ComputeRoutesTiled(ThreadPool& thread_pool) {
+	static constexpr size_t TILE_SIZE = 64;
+	const size_t tile_count = (vertex_count_ + TILE_SIZE - 1) / TILE_SIZE;
+	auto get_tile_begin = [](size_t tile_idx) {
+		return tile_idx * TILE_SIZE;
+	};
+	auto get_tile_end = [this](size_t tile_idx) {
+		return std::min((tile_idx + 1) * TILE_SIZE, vertex_count_);
+	};
+
+	// pivot rows (TILE_SIZE x V) and pivot columns (V x TILE_SIZE) as they are
+	// at the step of their pivot
+	std::vector<TableWeight> pivot_row_weights(TILE_SIZE * vertex_count_);
+	std::vector<uint32_t> pivot_row_prev_edges(TILE_SIZE * vertex_count_);
+	std::vector<TableWeight> pivot_column_weights(vertex_count_ * TILE_SIZE);
+	std::vector<uint32_t> pivot_column_prev_edges(vertex_count_ * TILE_SIZE);
+
+	for (size_t pivot_tile = 0; pivot_tile < tile_count; ++pivot_tile) {
+		const VertexId pivot_begin = get_tile_begin(pivot_tile);
+		const VertexId pivot_end = get_tile_end(pivot_tile);
+
+		// processes the pivots of the block over the tile [rows) x [columns) in order,
+		// optionally recording the pivot row and column segments of the tile first
+		auto process_tile = [&](size_t row_tile, size_t column_tile,
+				bool record_pivot_rows, bool record_pivot_columns) {
+			const VertexId row_begin = get_tile_begin(row_tile);
+			const VertexId row_end = get_tile_end(row_tile);
+			const VertexId column_begin = get_tile_begin(column_tile);
+			const size_t column_count = get_tile_end(column_tile) - column_begin;
+			for (VertexId pivot = pivot_begin; pivot < pivot_end; ++pivot) {
+				const size_t pivot_idx = pivot - pivot_begin;
+				const size_t pivot_row_offset = pivot_idx * vertex_count_
+						+ column_begin;
+				if (record_pivot_rows) {
+					const size_t cell_idx = GetCellIndex(pivot, column_begin);
+					std::copy_n(&route_weights_[cell_idx], column_count,
+							&pivot_row_weights[pivot_row_offset]);
+					std::copy_n(&route_prev_edges_[cell_idx], column_count,
+							&pivot_row_prev_edges[pivot_row_offset]);
+				}
+				if (record_pivot_columns) {
+					for (VertexId row = row_begin; row < row_end; ++row) {
+						const size_t cell_idx = GetCellIndex(row, pivot);
+						pivot_column_weights[row * TILE_SIZE + pivot_idx] =
+								route_weights_[cell_idx];
+						pivot_column_prev_edges[row * TILE_SIZE + pivot_idx] =
+								route_prev_edges_[cell_idx];
+					}
+				}
+				for (VertexId row = row_begin; row < row_end; ++row) {
+					const size_t cell_idx = GetCellIndex(row, column_begin);
+					RelaxRowSegment(pivot_column_weights[row * TILE_SIZE + pivot_idx],
+							pivot_column_prev_edges[row * TILE_SIZE + pivot_idx],
+							&pivot_row_weights[pivot_row_offset],
+							&pivot_row_prev_edges[pivot_row_offset],
+							&route_weights_[cell_idx], &route_prev_edges_[cell_idx],
+							column_count);
+				}
+			}
+		};
+
+		// phase 1: the diagonal tile records both its pivot rows and columns
+		process_tile(pivot_tile, pivot_tile, true, true);
+
+		// phase 2: the tiles of the pivot rows and the pivot columns
+		thread_pool.ParallelFor(2 * tile_count, [&](size_t task_idx) {
+			const size_t tile = task_idx / 2;
+			if (tile == pivot_tile) {
+				return;
+			}
+			if (task_idx % 2 == 0) {
+				process_tile(pivot_tile, tile, true, false);
+			} else {
+				process_tile(tile, pivot_tile, false, true);
+			}
+		});
+
+		// phase 3: the remaining tiles depend only on the recorded pivot rows and columns
+		thread_pool.ParallelFor(tile_count * tile_count, [&](size_t task_idx) {
+			const size_t row_tile = task_idx / tile_count;
+			const size_t column_tile = task_idx % tile_count;
+			if (row_tile != pivot_tile && column_tile != pivot_tile) {
+				process_tile(row_tile, column_tile, false, false);
+			}
+		});
 	}
-	std::reverse(std::begin(edges), std::end(edges));
+}
 
-	const RouteId route_id = next_route_id_++;
-	const size_t route_edge_count = edges.size();
-	expanded_routes_cache_[route_id] = std::move(edges);
-	return RouteInfo { route_id, weight, route_edge_count };
+template<typename Weight, typename Encoding>
+std::vector<Weight> Router<Weight, Encoding>::ComputeWeightMatrix(
+		const std::vector<VertexId>& sources,
+		const std::vector<VertexId>& targets) const {
+	std::vector<Weight> weights;
+	weights.reserve(sources.size() * targets.size());
+	for (const VertexId source : sources) {
+		const TableWeight* row = &route_weights_[GetCellIndex(source, 0)];
+		for (const VertexId target : targets) {
+			weights.push_back(Encoding::Decode(row[target]));
+		}
+	}
+	return weights;
 }
 
-template<typename Weight>
-EdgeId Router<Weight>::GetRouteEdge(RouteId route_id, size_t edge_idx) const {
-	return expanded_routes_cache_.at(route_id)[edge_idx];
+// Instead of recomputing the whole table, an update only repairs it:
+// the rows whose routes lost some weight to a dearer edge are recomputed from
+// scratch by Dijkstra, then the cheaper edges are inserted into all rows
+// by relaxing them through the sources of these edges
+template<typename Weight, typename Encoding>
+void Router<Weight, Encoding>::UpdateRoutes(const GraphChange& change) {
+	const size_t old_vertex_count = vertex_count_;
+	vertex_count_ = graph_.GetVertexCount();
+	assert(graph_.GetEdgeCount() < NO_EDGE);
+	if (vertex_count_ != old_vertex_count) {
+		GrowTables(old_vertex_count);
+	}
+
+	// a row is affected by a dearer edge only if the edge is in its tree of routes,
+	// that is it is the last edge of the route to the edge's target
+	if (!change.dearer_edges.empty()) {
+		std::vector<std::pair<VertexId, uint32_t>> dearer_edges;
+		dearer_edges.reserve(change.dearer_edges.size());
+		for (const EdgeId edge_id : change.dearer_edges) {
+			dearer_edges.emplace_back(graph_.GetEdge(edge_id).to,
+					static_cast<uint32_t>(edge_id));
+		}
+		const auto& route_prev_edges = route_prev_edges_;
+		for (VertexId vertex_from = 0; vertex_from < old_vertex_count;
+				++vertex_from) {
+			const bool is_affected = std::any_of(std::begin(dearer_edges),
+					std::end(dearer_edges), [&](const auto& edge) {
+						return route_prev_edges[GetCellIndex(vertex_from,
+								edge.first)] == edge.second;
+					});
+			if (is_affected) {
+				RecomputeRow(vertex_from);
+			}
+		}
+	}
+
+	// the cheaper edges out of one vertex are inserted together: an optimal route
+	// leaves a vertex at most once, so it takes at most one of them
+	std::vector<EdgeId> cheaper_edges = change.cheaper_edges;
+	std::sort(std::begin(cheaper_edges), std::end(cheaper_edges),
+			[this](EdgeId lhs, EdgeId rhs) {
+				return std::pair(graph_.GetEdgeSource(lhs), lhs)
+						< std::pair(graph_.GetEdgeSource(rhs), rhs);
+			});
+	std::vector<EdgeId> source_edges;
+	for (auto it = std::begin(cheaper_edges); it != std::end(cheaper_edges);) {
+		const VertexId source = graph_.GetEdgeSource(*it);
+		source_edges.clear();
+		for (; it != std::end(cheaper_edges) && graph_.GetEdgeSource(*it) == source;
+				++it) {
+			source_edges.push_back(*it);
+		}
+		InsertEdges(source, source_edges);
+	}
 }
 
-template<typename Weight>
-void Router<Weight>::RemoveRoute(RouteId route_id) {
-	expanded_routes_cache_.erase(route_id);
+// the new vertices have no routes but the empty ones to themselves
+template<typename Weight, typename Encoding>
+void Router<Weight, Encoding>::GrowTables(size_t old_vertex_count) {
+	Snapshot::FlatArray<TableWeight> route_weights(vertex_count_ * vertex_count_,
+			NO_ROUTE);
+	Snapshot::FlatArray<uint32_t> route_prev_edges(vertex_count_ * vertex_count_,
+			NO_EDGE);
+	const TableWeight* old_route_weights = std::as_const(route_weights_).data();
+	const uint32_t* old_route_prev_edges =
+			std::as_const(route_prev_edges_).data();
+	for (VertexId vertex_from = 0; vertex_from < old_vertex_count;
+			++vertex_from) {
+		const size_t old_row = vertex_from * old_vertex_count;
+		std::copy_n(old_route_weights + old_row, old_vertex_count,
+				&route_weights[GetCellIndex(vertex_from, 0)]);
+		std::copy_n(old_route_prev_edges + old_row, old_vertex_count,
+				&route_prev_edges[GetCellIndex(vertex_from, 0)]);
+	}
+	for (VertexId vertex = old_vertex_count; vertex < vertex_count_; ++vertex) {
+		route_weights[GetCellIndex(vertex, vertex)] = 0;
+	}
+	route_weights_ = std::move(route_weights);
+	route_prev_edges_ = std::move(route_prev_edges);
+}
+
+template<typename Weight, typename Encoding>
+void Router<Weight, Encoding>::RecomputeRow(VertexId vertex_from) {
+	TableWeight* weights = &route_weights_[GetCellIndex(vertex_from, 0)];
+	uint32_t* prev_edges = &route_prev_edges_[GetCellIndex(vertex_from, 0)];
+	std::fill_n(weights, vertex_count_, NO_ROUTE);
+	std::fill_n(prev_edges, vertex_count_, NO_EDGE);
+
+	using QueueItem = std::pair<TableWeight, VertexId>;
+	std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+	weights[vertex_from] = 0;
+	queue.emplace(0, vertex_from);
+	while (!queue.empty()) {
+		const auto [weight, vertex] = queue.top();
+		queue.pop();
+		if (weight > weights[vertex]) {
+			continue;
+		}
+		for (const auto& arc : graph_.GetOutArcs(vertex)) {
+			const TableWeight candidate_weight = Encoding::Add(weight,
+					Encoding::Encode(arc.weight));
+			if (candidate_weight < weights[arc.to]) {
+				weights[arc.to] = candidate_weight;
+				prev_edges[arc.to] = arc.edge_id;
+				queue.emplace(candidate_weight, arc.to);
+			}
+		}
+	}
+}
+
+template<typename Weight, typename Encoding>
+void Router<Weight, Encoding>::InsertEdges(VertexId source,
+		const std::vector<EdgeId>& edge_ids) {
+	// the best routes from the source that start with one of the edges
+	std::vector<TableWeight> weights_through(vertex_count_, NO_ROUTE);
+	std::vector<uint32_t> prev_edges_through(vertex_count_, NO_EDGE);
+	for (const EdgeId edge_id : edge_ids) {
+		const auto edge = graph_.GetEdge(edge_id);
+		const size_t row_to = GetCellIndex(edge.to, 0);
+		RelaxRowSegment(Encoding::Encode(edge.weight),
+				static_cast<uint32_t>(edge_id),
+				&route_weights_[row_to], &route_prev_edges_[row_to],
+				weights_through.data(), prev_edges_through.data(), vertex_count_);
+	}
+
+	for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+		const size_t row_from = GetCellIndex(vertex_from, 0);
+		RelaxRowSegment(route_weights_[GetCellIndex(vertex_from, source)],
+				NO_EDGE, weights_through.data(), prev_edges_through.data(),
+				&route_weights_[row_from], &route_prev_edges_[row_from],
+				vertex_count_);
+	}
+}
+
+template<typename Weight, typename Encoding>
+std::optional<typename Router<Weight, Encoding>::ExpandedRoute> Router<Weight,
+		Encoding>::ExpandRoute(VertexId from, VertexId to) const {
+	if (route_weights_[GetCellIndex(from, to)] == NO_ROUTE) {
+		return std::nullopt;
+	}
+	std::vector<EdgeId> edges;
+	for (uint32_t edge_id = route_prev_edges_[GetCellIndex(from, to)];
+			edge_id != NO_EDGE;
+			edge_id = route_prev_edges_[GetCellIndex(from,
+					graph_.GetEdgeSource(edge_id))]) {
+		edges.push_back(edge_id);
+	}
+	std::reverse(std::begin(edges), std::end(edges));
+
+	// a compact encoding has rounded the table weight, the route is weighed anew
+	Weight weight = Encoding::Decode(route_weights_[GetCellIndex(from, to)]);
+	if constexpr (!std::is_same_v<TableWeight, Weight>) {
+		weight = 0;
+		for (const EdgeId edge_id : edges) {
+			weight += graph_.GetEdge(edge_id).weight;
+		}
+	}
+	return ExpandedRoute { weight, std::move(edges) };
 }
 
 }
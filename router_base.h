@@ -0,0 +1,134 @@
+/*
+ * router_base.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef ROUTER_BASE_H_
+#define ROUTER_BASE_H_
+
+#pragma once
+
+#include "graph.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Graph {
+
+// common interface of the routing engines: an engine only has to find the
+// optimal route as a sequence of edges, the bookkeeping of built routes is shared;
+// routes may be built and read concurrently, so engines must keep ExpandRoute thread-safe
+template<typename Weight>
+class RouterBase {
+public:
+	using RouteId = uint64_t;
+
+	struct RouteInfo {
+		RouteId id;
+		Weight weight;
+		size_t edge_count;
+	};
+
+	// edges changed in the graph of the engine since it was built or last updated;
+	// the graph is changed in place: vertices and edges are only appended, and
+	// a removed edge is kept with an infinite weight
+	struct GraphChange {
+		std::vector<EdgeId> cheaper_edges;  // added or with a lower weight
+		std::vector<EdgeId> dearer_edges;  // removed or with a higher weight
+	};
+
+	virtual ~RouterBase() = default;
+
+	std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+	EdgeId GetRouteEdge(RouteId route_id, size_t edge_idx) const;
+	void RemoveRoute(RouteId route_id);
+
+	// weights of the optimal routes from every source to every target, row-major
+	// (sources x targets), infinite where there is no route; the routes themselves
+	// are not built, so the engines can share the work between them
+	virtual std::vector<Weight> ComputeWeightMatrix(
+			const std::vector<VertexId>& sources,
+			const std::vector<VertexId>& targets) const = 0;
+
+	// brings the precomputed data up to date with the changed graph and drops
+	// the built routes; must not run concurrently with the queries
+	void Update(const GraphChange& change);
+
+	// writes the precomputed data of the engine, each engine can be restored
+	// from it by its constructor taking a Snapshot::Reader
+	virtual void Serialize(Snapshot::Writer& writer) const = 0;
+
+	// bytes taken by the precomputed data, the part mapped from a snapshot included
+	virtual size_t GetMemoryUsage() const = 0;
+
+	// lets an engine which computes routes on demand prepare the routes from
+	// the sources ahead of the queries; must not run concurrently with them
+	virtual void WarmUp(const std::vector<VertexId>&, ThreadPool&) {
+	}
+
+protected:
+	struct ExpandedRoute {
+		Weight weight;
+		std::vector<EdgeId> edges;  // in the order of traversal
+	};
+
+	virtual std::optional<ExpandedRoute> ExpandRoute(VertexId from,
+			VertexId to) const = 0;
+	virtual void UpdateRoutes(const GraphChange& change) = 0;
+
+private:
+	mutable std::atomic<RouteId> next_route_id_ = 0;
+	mutable std::mutex expanded_routes_mutex_;
+	mutable std::unordered_map<RouteId, std::vector<EdgeId>> expanded_routes_cache_; // routes are vectors of edges
+};
+
+template<typename Weight>
+std::optional<typename RouterBase<Weight>::RouteInfo> RouterBase<Weight>::BuildRoute(
+		VertexId from, VertexId to) const {
+	auto route = ExpandRoute(from, to);
+	if (!route) {
+		return std::nullopt;
+	}
+	const RouteId route_id = next_route_id_++;
+	const size_t route_edge_count = route->edges.size();
+	{
+		std::lock_guard lock(expanded_routes_mutex_);
+		expanded_routes_cache_[route_id] = std::move(route->edges);
+	}
+	return RouteInfo { route_id, route->weight, route_edge_count };
+}
+
+template<typename Weight>
+EdgeId RouterBase<Weight>::GetRouteEdge(RouteId route_id,
+		size_t edge_idx) const {
+	std::lock_guard lock(expanded_routes_mutex_);
+	return expanded_routes_cache_.at(route_id)[edge_idx];
+}
+
+template<typename Weight>
+void RouterBase<Weight>::RemoveRoute(RouteId route_id) {
+	std::lock_guard lock(expanded_routes_mutex_);
+	expanded_routes_cache_.erase(route_id);
+}
+
+template<typename Weight>
+void RouterBase<Weight>::Update(const GraphChange& change) {
+	{
+		std::lock_guard lock(expanded_routes_mutex_);
+		expanded_routes_cache_.clear();
+	}
+	UpdateRoutes(change);
+}
+
+}
+
+#endif /* ROUTER_BASE_H_ */
@@ -0,0 +1,232 @@
+/*
+ * server.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "server.h"
+
+#include "json_lib.h"
+#include "queries.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <list>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+using namespace std;
+
+namespace Server {
+namespace {
+constexpr size_t MAX_LINE_SIZE = 1 << 20;
+constexpr int STOP_POLL_INTERVAL_MS = 200;  // how often the listener checks for a stop
+
+volatile sig_atomic_t stop_requested = 0;
+
+void RequestStop(int) {
+	stop_requested = 1;
+}
+
+bool IsBlank(string_view line) {
+	return all_of(begin(line), end(line), [](char ch) {
+		return ch == ' ' || ch == '\t' || ch == '\r';
+	});
+}
+
+// the writer is left with the response to the line; the latency recorded
+// for the request does not include reading and parsing the line
+void AnswerLine(const TransportRegister& db, string line,
+		Json::Writer& writer) {
+	writer.Clear();
+	try {
+		const auto request_doc = Json::Load(move(line));
+		Queries::ProcessOne(db, request_doc.GetRoot(), writer);
+	} catch (const exception& error) {
+		writer.Clear();
+		writer.BeginDict()
+			.Key("error_message").String(string("bad request: ") + error.what())
+			.EndDict();
+	}
+}
+
+// false once the client has gone
+bool SendAll(int fd, string_view data) {
+	while (!data.empty()) {
+		const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data.remove_prefix(sent);
+	}
+	return true;
+}
+
+// the responses to all the lines of a received chunk are sent together
+void ServeConnection(const TransportRegister& db, int fd) {
+	Json::Writer writer;
+	string pending;  // the beginning of a line not received whole yet
+	string responses;
+	char chunk[1 << 16];
+	while (true) {
+		const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			// the last request may end with the input instead of a newline
+			if (received == 0 && !IsBlank(pending)) {
+				AnswerLine(db, move(pending), writer);
+				SendAll(fd, string(writer.GetText()) + '\n');
+			}
+			return;
+		}
+		pending.append(chunk, received);
+
+		responses.clear();
+		size_t line_begin = 0;
+		for (size_t line_end = pending.find('\n'); line_end != string::npos;
+				line_end = pending.find('\n', line_begin)) {
+			const string_view line = string_view(pending).substr(line_begin,
+					line_end - line_begin);
+			line_begin = line_end + 1;
+			if (IsBlank(line)) {
+				continue;
+			}
+			AnswerLine(db, string(line), writer);
+			responses += writer.GetText();
+			responses += '\n';
+		}
+		pending.erase(0, line_begin);
+		if (!SendAll(fd, responses)) {
+			return;
+		}
+		if (pending.size() > MAX_LINE_SIZE) {
+			SendAll(fd, "{\"error_message\": \"bad request: line too long\"}\n");
+			return;
+		}
+	}
+}
+
+[[noreturn]] void ThrowSocketError(const string& what, const string& path) {
+	throw runtime_error(
+			"cannot " + what + " socket " + path + ": " + strerror(errno));
+}
+
+// a client served by a thread of its own; the socket is closed by the
+// listener once the thread has been joined
+struct Connection {
+	int fd = -1;
+	thread server;
+	atomic<bool> is_done = false;
+};
+}
+
+void ServeStream(const TransportRegister& db, istream& input,
+		ostream& output) {
+	Json::Writer writer;
+	for (string line; getline(input, line);) {
+		if (IsBlank(line)) {
+			continue;
+		}
+		AnswerLine(db, move(line), writer);
+		output << writer.GetText() << endl;
+	}
+}
+
+void ServeUnixSocket(const TransportRegister& db, const string& path) {
+	sockaddr_un address { };
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw runtime_error("socket path too long: " + path);
+	}
+	copy(begin(path), end(path), address.sun_path);
+
+	// only a socket is replaced, never a regular file
+	struct stat path_stat;
+	if (stat(path.c_str(), &path_stat) == 0 && S_ISSOCK(path_stat.st_mode)) {
+		unlink(path.c_str());
+	}
+	const int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0) {
+		ThrowSocketError("create", path);
+	}
+	if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address),
+			sizeof(address)) < 0) {
+		close(listen_fd);
+		ThrowSocketError("bind", path);
+	}
+	if (listen(listen_fd, SOMAXCONN) < 0) {
+		close(listen_fd);
+		unlink(path.c_str());
+		ThrowSocketError("listen on", path);
+	}
+
+	// the handlers only raise the flag, which the listener polls for
+	stop_requested = 0;
+	struct sigaction stop_action { };
+	stop_action.sa_handler = RequestStop;
+	sigemptyset(&stop_action.sa_mask);
+	struct sigaction old_int_action, old_term_action;
+	sigaction(SIGINT, &stop_action, &old_int_action);
+	sigaction(SIGTERM, &stop_action, &old_term_action);
+
+	list<Connection> connections;
+	auto join_done_connections = [&connections]() {
+		for (auto it = begin(connections); it != end(connections);) {
+			if (it->is_done) {
+				it->server.join();
+				close(it->fd);
+				it = connections.erase(it);
+			} else {
+				++it;
+			}
+		}
+	};
+	while (!stop_requested) {
+		pollfd listen_poll { listen_fd, POLLIN, 0 };
+		const int ready_count = poll(&listen_poll, 1, STOP_POLL_INTERVAL_MS);
+		join_done_connections();
+		if (ready_count <= 0) {
+			continue;
+		}
+		const int client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (client_fd < 0) {
+			continue;
+		}
+		Connection& connection = connections.emplace_back();
+		connection.fd = client_fd;
+		connection.server = thread([&db, &connection] {
+			ServeConnection(db, connection.fd);
+			connection.is_done = true;
+		});
+	}
+
+	// the clients still connected are cut off, which ends their reads
+	for (auto& connection : connections) {
+		shutdown(connection.fd, SHUT_RDWR);
+	}
+	for (auto& connection : connections) {
+		connection.server.join();
+		close(connection.fd);
+	}
+	close(listen_fd);
+	unlink(path.c_str());
+	sigaction(SIGINT, &old_int_action, nullptr);
+	sigaction(SIGTERM, &old_term_action, nullptr);
+}
+}
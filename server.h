@@ -0,0 +1,35 @@
+/*
+ * server.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#pragma once
+
+#include "transport_register.h"
+
+#include <iostream>
+#include <string>
+
+// answers stat requests on a register which is built once and kept: every
+// request is a json object on a line of its own (newline-delimited json), as
+// in stat_requests, and is answered by a line with the same response as in a
+// batch. A line which cannot be answered gets {"error_message": ...}
+namespace Server {
+// the requests are answered one by one, in order, until the end of the input;
+// every response is flushed right away
+void ServeStream(const TransportRegister& db, std::istream& input,
+		std::ostream& output);
+
+// listens on a unix domain socket at the path (a stale socket file there is
+// replaced) and serves every client by a thread of its own; returns once
+// SIGINT or SIGTERM is received, after the clients have been disconnected.
+// Throws std::runtime_error if the socket cannot be set up
+void ServeUnixSocket(const TransportRegister& db, const std::string& path);
+}
+
+#endif /* SERVER_H_ */
@@ -0,0 +1,127 @@
+/*
+ * snapshot.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+
+using namespace std;
+
+namespace Snapshot {
+
+namespace {
+
+const array<char, 8> MAGIC = { 'T', 'R', 'S', 'N', 'A', 'P', '\0', '\0' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// makes sure that a snapshot is only read by a build with the same data layout
+struct Header {
+	array<char, 8> magic;
+	uint32_t format_version;
+	uint32_t byte_order_mark;
+	uint32_t size_t_size;
+	uint32_t double_size;
+};
+
+Header MakeHeader() {
+	return {MAGIC, FORMAT_VERSION, BYTE_ORDER_MARK,
+		static_cast<uint32_t>(sizeof(size_t)),
+		static_cast<uint32_t>(sizeof(double))};
+}
+
+}
+
+MappedFile::MappedFile(const string& path) {
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error("cannot open snapshot " + path);
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0) {
+		close(fd);
+		throw runtime_error("cannot stat snapshot " + path);
+	}
+	size_ = file_stat.st_size;
+	if (size_ > 0) {
+		void* const data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			throw runtime_error("cannot map snapshot " + path);
+		}
+		data_ = static_cast<const char*>(data);
+	}
+	// the mapping stays valid after the descriptor is closed
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (data_) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+}
+
+Writer::Writer(ostream& output) :
+		output_(output) {
+	Write(MakeHeader());
+}
+
+void Writer::WriteString(string_view value) {
+	Write<uint64_t>(value.size());
+	WriteBytes(value.data(), value.size());
+}
+
+void Writer::WriteBytes(const void* bytes, size_t size) {
+	output_.write(static_cast<const char*>(bytes), size);
+	offset_ += size;
+}
+
+void Writer::Align(size_t alignment) {
+	static const array<char, 64> PADDING = { };
+	const size_t padding = (alignment - offset_ % alignment) % alignment;
+	WriteBytes(PADDING.data(), padding);
+}
+
+Reader::Reader(shared_ptr<const MappedFile> mapped_file) :
+		mapped_file_(move(mapped_file)) {
+	const Header expected_header = MakeHeader();
+	const auto header = Read<Header>();
+	if (header.magic != expected_header.magic) {
+		throw runtime_error("not a snapshot");
+	}
+	if (header.format_version != expected_header.format_version
+			|| header.byte_order_mark != expected_header.byte_order_mark
+			|| header.size_t_size != expected_header.size_t_size
+			|| header.double_size != expected_header.double_size) {
+		throw runtime_error("incompatible snapshot format");
+	}
+}
+
+string Reader::ReadString() {
+	const size_t size = Read<uint64_t>();
+	const char* const data = Take(size);
+	return string(data, size);
+}
+
+const char* Reader::Take(size_t size) {
+	if (size > mapped_file_->GetSize() - offset_) {
+		throw runtime_error("truncated snapshot");
+	}
+	const char* const data = mapped_file_->GetData() + offset_;
+	offset_ += size;
+	return data;
+}
+
+void Reader::Align(size_t alignment) {
+	Take((alignment - offset_ % alignment) % alignment);
+}
+
+}
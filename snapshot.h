@@ -0,0 +1,188 @@
+/*
+ * snapshot.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// binary snapshots of a built register: plain little-endian dumps of the data
+// structures, large arrays aligned so that they can be used in place once mapped
+namespace Snapshot {
+
+const uint32_t FORMAT_VERSION = 8;
+
+// read-only memory mapping of a whole file
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* GetData() const {
+		return data_;
+	}
+
+	size_t GetSize() const {
+		return size_;
+	}
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+};
+
+// contiguous array which either owns its elements or views them inside a mapped
+// snapshot (keeping the mapping alive); the view is copied on the first write access
+template<typename T>
+class FlatArray {
+public:
+	FlatArray() = default;
+
+	FlatArray(size_t size, const T& value) :
+			owned_(size, value) {
+	}
+
+	FlatArray(const T* view, size_t size,
+			std::shared_ptr<const MappedFile> mapped_file) :
+			view_(view), view_size_(size), mapped_file_(move(mapped_file)) {
+	}
+
+	size_t size() const {
+		return view_ ? view_size_ : owned_.size();
+	}
+
+	const T* data() const {
+		return view_ ? view_ : owned_.data();
+	}
+
+	T* data() {
+		MakeOwned();
+		return owned_.data();
+	}
+
+	const T& operator[](size_t idx) const {
+		return data()[idx];
+	}
+
+	T& operator[](size_t idx) {
+		return data()[idx];
+	}
+
+private:
+	void MakeOwned() {
+		if (view_) {
+			owned_.assign(view_, view_ + view_size_);
+			view_ = nullptr;
+			view_size_ = 0;
+			mapped_file_.reset();
+		}
+	}
+
+	std::vector<T> owned_;
+	const T* view_ = nullptr;
+	size_t view_size_ = 0;
+	std::shared_ptr<const MappedFile> mapped_file_;
+};
+
+class Writer {
+public:
+	explicit Writer(std::ostream& output);
+
+	template<typename T>
+	void Write(const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		WriteBytes(&value, sizeof(T));
+	}
+
+	void WriteString(std::string_view value);
+
+	template<typename T>
+	void WriteArray(const T* values, size_t size) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		Write<uint64_t>(size);
+		Align(alignof(T));
+		WriteBytes(values, size * sizeof(T));
+	}
+
+	template<typename T>
+	void WriteVector(const std::vector<T>& values) {
+		WriteArray(values.data(), values.size());
+	}
+
+private:
+	void WriteBytes(const void* bytes, size_t size);
+	void Align(size_t alignment);
+
+	std::ostream& output_;
+	size_t offset_ = 0;
+};
+
+class Reader {
+public:
+	// checks the header of the snapshot, throws std::runtime_error if it is not compatible
+	explicit Reader(std::shared_ptr<const MappedFile> mapped_file);
+
+	template<typename T>
+	T Read() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		T value;
+		std::copy_n(Take(sizeof(T)), sizeof(T),
+				reinterpret_cast<char*>(&value));
+		return value;
+	}
+
+	std::string ReadString();
+
+	template<typename T>
+	std::vector<T> ReadVector() {
+		const auto [values, size] = ReadArray<T>();
+		return std::vector<T>(values, values + size);
+	}
+
+	// the array is not copied but viewed inside the mapped snapshot
+	template<typename T>
+	FlatArray<T> ReadFlatArray() {
+		const auto [values, size] = ReadArray<T>();
+		return FlatArray<T>(values, size, mapped_file_);
+	}
+
+private:
+	template<typename T>
+	std::pair<const T*, size_t> ReadArray() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		const size_t size = Read<uint64_t>();
+		Align(alignof(T));
+		if (size > (mapped_file_->GetSize() - offset_) / sizeof(T)) {
+			throw std::runtime_error("truncated snapshot");
+		}
+		return {reinterpret_cast<const T*>(Take(size * sizeof(T))), size};
+	}
+
+	const char* Take(size_t size);
+	void Align(size_t alignment);
+
+	std::shared_ptr<const MappedFile> mapped_file_;
+	size_t offset_ = 0;
+};
+
+}
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,172 @@
+/*
+ * spatial_index.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <queue>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+double GetCoordinate(const Earth::UnitVector& point, uint8_t axis) {
+	switch (axis) {
+	case 0:
+		return point.x;
+	case 1:
+		return point.y;
+	default:
+		return point.z;
+	}
+}
+
+double ComputeSquaredChordLength(const Earth::UnitVector& lhs,
+		const Earth::UnitVector& rhs) {
+	const double dx = lhs.x - rhs.x;
+	const double dy = lhs.y - rhs.y;
+	const double dz = lhs.z - rhs.z;
+	return dx * dx + dy * dy + dz * dz;
+}
+}
+
+class SpatialIndex::Candidates {
+public:
+	Candidates(size_t max_count, double max_squared_chord_length) :
+			max_count_(max_count), max_squared_chord_length_(
+					max_squared_chord_length) {
+	}
+
+	// the squared chord length beyond which no point can be a candidate any more
+	double GetBound() const {
+		return queue_.size() < max_count_ ?
+				max_squared_chord_length_ :
+				min(max_squared_chord_length_, get<0>(queue_.top()));
+	}
+
+	void Consider(size_t node_idx, uint32_t id, double squared_chord_length) {
+		if (squared_chord_length > max_squared_chord_length_) {
+			return;
+		}
+		const Candidate candidate { squared_chord_length, id, node_idx };
+		if (queue_.size() < max_count_) {
+			queue_.push(candidate);
+		} else if (candidate < queue_.top()) {
+			queue_.pop();
+			queue_.push(candidate);
+		}
+	}
+
+	// the indices of the nodes, nearest first
+	vector<size_t> ExtractNodeIndices() {
+		vector<size_t> node_indices(queue_.size());
+		for (auto it = rbegin(node_indices); it != rend(node_indices); ++it) {
+			*it = get<2>(queue_.top());
+			queue_.pop();
+		}
+		return node_indices;
+	}
+
+private:
+	// ordered by the squared chord length, then by the id
+	using Candidate = tuple<double, uint32_t, size_t>;
+
+	size_t max_count_;
+	double max_squared_chord_length_;
+	priority_queue<Candidate> queue_;
+};
+
+SpatialIndex::SpatialIndex(const vector<Earth::UnitVector>& points) {
+	nodes_.reserve(points.size());
+	for (uint32_t id = 0; id < points.size(); ++id) {
+		nodes_.push_back( { points[id], id, 0 });
+	}
+	Build(0, nodes_.size());
+}
+
+void SpatialIndex::Build(size_t range_begin, size_t range_end) {
+	if (range_end - range_begin <= 1) {
+		return;
+	}
+	const auto nodes_begin = begin(nodes_) + range_begin;
+	const auto nodes_end = begin(nodes_) + range_end;
+	auto is_less_by = [](uint8_t axis) {
+		return [axis](const Node& lhs, const Node& rhs) {
+			return GetCoordinate(lhs.point, axis) < GetCoordinate(rhs.point, axis);
+		};
+	};
+
+	// the range is split across its widest coordinate
+	double widest_spread = -1.0;
+	uint8_t widest_axis = 0;
+	for (uint8_t axis = 0; axis < 3; ++axis) {
+		const auto [min_it, max_it] = minmax_element(nodes_begin, nodes_end,
+				is_less_by(axis));
+		const double spread = GetCoordinate(max_it->point, axis)
+				- GetCoordinate(min_it->point, axis);
+		if (spread > widest_spread) {
+			widest_spread = spread;
+			widest_axis = axis;
+		}
+	}
+
+	const size_t middle = range_begin + (range_end - range_begin) / 2;
+	nth_element(nodes_begin, begin(nodes_) + middle, nodes_end,
+			is_less_by(widest_axis));
+	nodes_[middle].axis = widest_axis;
+	Build(range_begin, middle);
+	Build(middle + 1, range_end);
+}
+
+vector<SpatialIndex::Neighbour> SpatialIndex::FindNearest(
+		const Earth::UnitVector& point, size_t max_count,
+		double max_distance) const {
+	if (max_count == 0) {
+		return {};
+	}
+	const double max_chord_length = Earth::ComputeChordLength(max_distance);
+	Candidates candidates(max_count, max_chord_length * max_chord_length);
+	Search(0, nodes_.size(), point, candidates);
+
+	vector<Neighbour> neighbours;
+	for (const size_t node_idx : candidates.ExtractNodeIndices()) {
+		const Node& node = nodes_[node_idx];
+		const double distance = Earth::Distance(node.point, point);
+		// the chord and the distance are rounded differently right at the bound
+		if (distance <= max_distance) {
+			neighbours.push_back( { node.id, distance });
+		}
+	}
+	return neighbours;
+}
+
+void SpatialIndex::Search(size_t range_begin, size_t range_end,
+		const Earth::UnitVector& point, Candidates& candidates) const {
+	if (range_begin == range_end) {
+		return;
+	}
+	const size_t middle = range_begin + (range_end - range_begin) / 2;
+	const Node& node = nodes_[middle];
+	candidates.Consider(middle, node.id,
+			ComputeSquaredChordLength(node.point, point));
+
+	// the side of the point first, so that the bound is tight for the other one
+	const double offset = GetCoordinate(point, node.axis)
+			- GetCoordinate(node.point, node.axis);
+	if (offset < 0) {
+		Search(range_begin, middle, point, candidates);
+		if (offset * offset <= candidates.GetBound()) {
+			Search(middle + 1, range_end, point, candidates);
+		}
+	} else {
+		Search(middle + 1, range_end, point, candidates);
+		if (offset * offset <= candidates.GetBound()) {
+			Search(range_begin, middle, point, candidates);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+/*
+ * spatial_index.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef SPATIAL_INDEX_H_
+#define SPATIAL_INDEX_H_
+
+#pragma once
+
+#include "distance_utils.h"
+
+#include <cstdint>
+#include <vector>
+
+// k-d tree over points of the earth's surface, kept as unit vectors in 3d: a
+// search prunes the subtrees beyond the splitting planes by the straight-line
+// (chord) distance, which needs no trigonometry and has no seam at the
+// antimeridian or the poles; only the points found are measured along the sphere
+class SpatialIndex {
+public:
+	struct Neighbour {
+		uint32_t id;  // the index of the point
+		double distance;  // in meters, along the earth's surface
+	};
+
+	SpatialIndex() = default;
+	explicit SpatialIndex(const std::vector<Earth::UnitVector>& points);
+
+	// the points nearest to the given one, nearest first (equally near ones by
+	// index): at most max_count of them, none farther than max_distance
+	std::vector<Neighbour> FindNearest(const Earth::UnitVector& point,
+			size_t max_count, double max_distance) const;
+
+private:
+	struct Node {
+		Earth::UnitVector point;
+		uint32_t id;
+		uint8_t axis;  // the coordinate splitting the subtree of the node
+	};
+
+	// the nearest points found so far, the farthest first
+	class Candidates;
+
+	void Build(size_t range_begin, size_t range_end);
+
+	void Search(size_t range_begin, size_t range_end,
+			const Earth::UnitVector& point, Candidates& candidates) const;
+
+	// the tree is implicit: the root of a range of nodes is in its middle, with
+	// the nodes below its splitting plane before it and the others after it
+	std::vector<Node> nodes_;
+};
+
+#endif /* SPATIAL_INDEX_H_ */
@@ -0,0 +1,131 @@
+/*
+ * json_round_trip_test.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "json_lib.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// names which have to be escaped again on output
+const vector<string> NAMES = { "A\\B", "Line\n1", "Say \"hi\"", "Bell\x07",
+		"Plain" };
+
+int failure_count = 0;
+
+void Check(bool condition, const string& what) {
+	if (!condition) {
+		cerr << "FAILED: " << what << endl;
+		++failure_count;
+	}
+}
+
+bool HasControlCharacters(string_view text) {
+	return any_of(begin(text), end(text), [](char c) {
+		return static_cast<unsigned char>(c) < 0x20;
+	});
+}
+
+// the names, escaped in the input as a client would escape them
+const string INPUT =
+		R"(["A\\B", "Line\n1", "Say \"hi\"", "Bell\u0007", "Plain"])";
+
+void CheckNames(const Json::Document& document, const string& source) {
+	const auto& nodes = document.GetRoot().AsArray();
+	Check(nodes.size() == NAMES.size(), source + ": name count");
+	for (size_t i = 0; i < min(nodes.size(), NAMES.size()); ++i) {
+		Check(nodes[i].AsString() == NAMES[i], source + ": name " + NAMES[i]);
+	}
+}
+
+void TestLoadUnescapes() {
+	CheckNames(Json::Load(INPUT), "Load");
+}
+
+void TestPrintRoundTrip() {
+	ostringstream output;
+	Json::Print(Json::Load(INPUT), output);
+	const string text = output.str();
+	Check(!HasControlCharacters(text), "Print: raw control characters");
+	CheckNames(Json::Load(text), "Print");
+}
+
+
+void TestWriterRoundTrip() {
+	// the names both as values and as keys, the way responses are streamed
+	const auto input = Json::Load(INPUT);
+	Json::Writer values_writer;
+	values_writer.BeginArray();
+	for (const auto& node : input.GetRoot().AsArray()) {
+		values_writer.String(node.AsString());
+	}
+	values_writer.EndArray();
+	Json::Writer keys_writer;
+	keys_writer.BeginDict();
+	for (const auto& node : input.GetRoot().AsArray()) {
+		keys_writer.Key(node.AsString()).Int(0);
+	}
+	keys_writer.EndDict();
+
+	Check(!HasControlCharacters(values_writer.GetText()),
+			"Writer::String: raw control characters");
+	Check(!HasControlCharacters(keys_writer.GetText()),
+			"Writer::Key: raw control characters");
+	CheckNames(Json::Load(string(values_writer.GetText())), "Writer::String");
+	const auto keys = Json::Load(string(keys_writer.GetText()));
+	Check(keys.GetRoot().AsMap().size() == NAMES.size(), "Writer::Key: key count");
+	for (const auto& name : NAMES) {
+		Check(keys.GetRoot().AsMap().count(string_view(name)) == 1,
+				"Writer::Key: " + name);
+	}
+}
+
+void TestSurrogatePairs() {
+	// U+1F600 is one 4-byte utf-8 sequence, not two encoded surrogates
+	const auto document = Json::Load(R"(["\uD83D\uDE00", "\u00e9\u20ac"])");
+	const auto& nodes = document.GetRoot().AsArray();
+	Check(nodes[0].AsString() == "\xF0\x9F\x98\x80", "surrogate pair");
+	Check(nodes[1].AsString() == "\xC3\xA9\xE2\x82\xAC", "basic plane");
+
+	for (const string input : { R"(["\uD83D"])", R"(["\uD83Dx"])",
+			R"(["\uD83D\u0041"])", R"(["\uDE00"])" }) {
+		bool is_rejected = false;
+		try {
+			Json::Load(input);
+		} catch (const Json::ParsingError&) {
+			is_rejected = true;
+		}
+		Check(is_rejected, "unpaired surrogate in " + input);
+	}
+}
+
+void Run(void (*test)(), const string& name) {
+	try {
+		test();
+	} catch (const exception& error) {
+		Check(false, name + ": " + error.what());
+	}
+}
+}
+
+int main() {
+	Run(TestLoadUnescapes, "TestLoadUnescapes");
+	Run(TestPrintRoundTrip, "TestPrintRoundTrip");
+	Run(TestWriterRoundTrip, "TestWriterRoundTrip");
+	Run(TestSurrogatePairs, "TestSurrogatePairs");
+	if (failure_count > 0) {
+		cerr << failure_count << " checks failed" << endl;
+		return 1;
+	}
+	cerr << "OK" << endl;
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * settings_test.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "json_lib.h"
+#include "parser.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+int failure_count = 0;
+
+void Check(bool condition, const string& what) {
+	if (!condition) {
+		cerr << "FAILED: " << what << endl;
+		++failure_count;
+	}
+}
+
+bool IsRejected(const string& settings, string_view key) {
+	const auto document = Json::Load(settings);
+	try {
+		Settings::ReadCount(document.GetRoot().AsMap(), key, 1);
+	} catch (const invalid_argument&) {
+		return true;
+	}
+	return false;
+}
+
+void TestReadCount() {
+	const auto document = Json::Load(R"({"router_threads": 4, "zero": 0})");
+	const auto& settings = document.GetRoot().AsMap();
+	Check(Settings::ReadCount(settings, "router_threads", 1) == 4, "given count");
+	Check(Settings::ReadCount(settings, "zero", 1) == 0, "zero count");
+	Check(Settings::ReadCount(settings, "missing", 7) == 7, "default count");
+}
+
+void TestNegativeCounts() {
+	Check(IsRejected(R"({"router_threads": -1})", "router_threads"),
+			"negative router_threads");
+	Check(IsRejected(R"({"route_cache_size": -1})", "route_cache_size"),
+			"negative route_cache_size");
+	Check(IsRejected(R"({"route_row_cache_size": -1})", "route_row_cache_size"),
+			"negative route_row_cache_size");
+}
+
+void Run(void (*test)(), const string& name) {
+	try {
+		test();
+	} catch (const exception& error) {
+		Check(false, name + ": " + error.what());
+	}
+}
+}
+
+int main() {
+	Run(TestReadCount, "TestReadCount");
+	Run(TestNegativeCounts, "TestNegativeCounts");
+	if (failure_count > 0) {
+		cerr << failure_count << " checks failed" << endl;
+		return 1;
+	}
+	cerr << "OK" << endl;
+	return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * thread_pool.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t thread_count) {
+	if (thread_count == 0) {
+		thread_count = max(thread::hardware_concurrency(), 1u);
+	}
+	ranges_ = make_unique<IndexRange[]>(thread_count);
+	workers_.reserve(thread_count - 1);
+	for (size_t thread_idx = 1; thread_idx < thread_count; ++thread_idx) {
+		workers_.emplace_back([this, thread_idx] {
+			RunWorker(thread_idx);
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard lock(mutex_);
+		stopping_ = true;
+	}
+	job_ready_.notify_all();
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+}
+
+void ThreadPool::PrepareRanges(size_t count) {
+	const size_t thread_count = GetThreadCount();
+	for (size_t thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+		IndexRange& range = ranges_[thread_idx];
+		lock_guard lock(range.mutex);
+		range.begin = count * thread_idx / thread_count;
+		range.end = count * (thread_idx + 1) / thread_count;
+	}
+}
+
+optional<size_t> ThreadPool::PopIndex(size_t thread_idx) {
+	IndexRange& range = ranges_[thread_idx];
+	do {
+		lock_guard lock(range.mutex);
+		if (range.begin < range.end) {
+			return range.begin++;
+		}
+	} while (StealIndices(thread_idx));
+	return nullopt;
+}
+
+bool ThreadPool::StealIndices(size_t thread_idx) {
+	// victims are tried round-robin starting from the next thread
+	const size_t thread_count = GetThreadCount();
+	for (size_t shift = 1; shift < thread_count; ++shift) {
+		IndexRange& victim = ranges_[(thread_idx + shift) % thread_count];
+		size_t stolen_begin = 0;
+		size_t stolen_end = 0;
+		{
+			lock_guard lock(victim.mutex);
+			if (victim.begin >= victim.end) {
+				continue;
+			}
+			stolen_end = victim.end;
+			victim.end -= (victim.end - victim.begin + 1) / 2;
+			stolen_begin = victim.end;
+		}
+		IndexRange& range = ranges_[thread_idx];
+		lock_guard lock(range.mutex);
+		range.begin = stolen_begin;
+		range.end = stolen_end;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::RunOnAllThreads(const function<void(size_t)>& job) {
+	{
+		lock_guard lock(mutex_);
+		job_ = &job;
+		++job_generation_;
+		busy_worker_count_ = workers_.size();
+	}
+	job_ready_.notify_all();
+
+	job(0);
+
+	// the job must stay alive until every worker has finished it
+	unique_lock lock(mutex_);
+	job_done_.wait(lock, [this] {
+		return busy_worker_count_ == 0;
+	});
+	job_ = nullptr;
+}
+
+void ThreadPool::RunWorker(size_t thread_idx) {
+	size_t seen_generation = 0;
+	while (true) {
+		const function<void(size_t)>* job = nullptr;
+		{
+			unique_lock lock(mutex_);
+			job_ready_.wait(lock, [this, seen_generation] {
+				return stopping_ || job_generation_ != seen_generation;
+			});
+			if (stopping_) {
+				return;
+			}
+			seen_generation = job_generation_;
+			job = job_;
+		}
+
+		(*job)(thread_idx);
+
+		lock_guard lock(mutex_);
+		if (--busy_worker_count_ == 0) {
+			job_done_.notify_one();
+		}
+	}
+}
@@ -0,0 +1,99 @@
+/*
+ * thread_pool.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: sergeynasekin
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads for fork-join parallel loops;
+// the thread calling ParallelFor takes part in the loop as well
+class ThreadPool {
+public:
+	// thread_count includes the calling thread; 0 means one per hardware thread
+	explicit ThreadPool(size_t thread_count);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t GetThreadCount() const {
+		return workers_.size() + 1;
+	}
+
+	// calls func(idx) for every idx in [0, count) and returns when all calls are done;
+	// the indices are split evenly between the threads, and a thread which runs out
+	// of its own indices steals half of the remaining ones of another thread,
+	// so uneven calls are balanced; must not be called from inside func.
+	// If calls throw, the first exception is rethrown once the other threads are done
+	template<typename Func>
+	void ParallelFor(size_t count, Func func) {
+		if (workers_.empty() || count <= 1) {
+			for (size_t idx = 0; idx < count; ++idx) {
+				func(idx);
+			}
+			return;
+		}
+		PrepareRanges(count);
+		std::mutex error_mutex;
+		std::exception_ptr error;
+		RunOnAllThreads([this, &func, &error_mutex, &error](size_t thread_idx) {
+			try {
+				while (const auto idx = PopIndex(thread_idx)) {
+					func(*idx);
+				}
+			} catch (...) {
+				std::lock_guard lock(error_mutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		});
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+private:
+	// indices [begin, end) not yet taken; the owner takes them from the front,
+	// thieves take the back half
+	struct alignas(64) IndexRange {
+		std::mutex mutex;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	void PrepareRanges(size_t count);
+	std::optional<size_t> PopIndex(size_t thread_idx);
+	bool StealIndices(size_t thread_idx);
+
+	void RunOnAllThreads(const std::function<void(size_t)>& job);
+	void RunWorker(size_t thread_idx);
+
+	std::vector<std::thread> workers_;
+	std::unique_ptr<IndexRange[]> ranges_;  // one per thread
+
+	std::mutex mutex_;
+	std::condition_variable job_ready_;
+	std::condition_variable job_done_;
+	const std::function<void(size_t)>* job_ = nullptr;
+	size_t job_generation_ = 0;
+	size_t busy_worker_count_ = 0;
+	bool stopping_ = false;
+};
+
+#endif /* THREAD_POOL_H_ */
@@ -7,77 +7,470 @@
 
 #include "transport_register.h"
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <numeric>
 #include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
-TransportRegister::TransportRegister(vector<BusOrStopInfo::InputQuery> data,
-		const Json::Dict& routing_settings_json) {
+TransportRegister::TransportRegister(BusOrStopInfo::BaseData data,
+		const Json::Dict& routing_settings_json, ThreadPool& thread_pool) :
+		stop_names_(move(data.stop_names)), bus_names_(move(data.bus_names)),
+		stop_infos_(move(data.stops)), bus_infos_(move(data.buses)),
+		stop_unit_vectors_(MakeUnitVectors(stop_infos_)), stop_index_(
+				stop_unit_vectors_), buses_(bus_infos_.size()) {
+	const Stopwatch stopwatch;
 
-	auto stops_end = partition(begin(data), end(data), [](const auto& item) {
-		return holds_alternative<BusOrStopInfo::Stop>(item);
+	thread_pool.ParallelFor(bus_infos_.size(), [this](size_t bus_id) {
+		buses_[bus_id] = MakeBusStats(bus_infos_[bus_id]);
 	});
+	BuildStopsBusIds(thread_pool);
 
-	// filter stops
-	BusOrStopInfo::StopsDict stops_dict;
-	for (const auto& item : Range { begin(data), stops_end }) {
-		const auto& stop = get<BusOrStopInfo::Stop>(item);
-		stops_dict[stop.name] = &stop;
-		stops_.insert( { stop.name, { } });
+	router_ = make_unique<TransportRouter>(stop_infos_, bus_infos_,
+			routing_settings_json, thread_pool);
+
+	perf_stats_->RecordPhase(PerfStats::Phase::GraphFill,
+			router_->GetBuildTimes().graph_fill);
+	perf_stats_->RecordPhase(PerfStats::Phase::RouterPrecompute,
+			router_->GetBuildTimes().router_precompute);
+	perf_stats_->RecordPhase(PerfStats::Phase::RegisterBuild,
+			stopwatch.GetElapsed());
+}
+
+// the buses of a stop are listed in the order of their names, once each;
+// the visits of the stops are laid out by counting, then filled concurrently:
+// every visit of a stop by a bus claims a slot of its own with an atomic cursor.
+// The visits of every stop are sorted and deduplicated in place, and the lists
+// are packed into the index
+void TransportRegister::BuildStopsBusIds(ThreadPool& thread_pool) {
+	const size_t stop_count = stop_infos_.size();
+	vector<BusOrStopInfo::BusId> buses_by_name(bus_infos_.size());
+	iota(begin(buses_by_name), end(buses_by_name), 0);
+	sort(begin(buses_by_name), end(buses_by_name),
+			[this](BusOrStopInfo::BusId lhs, BusOrStopInfo::BusId rhs) {
+				return bus_names_.GetName(lhs) < bus_names_.GetName(rhs);
+			});
+	vector<uint32_t> bus_ranks(bus_infos_.size());
+	for (uint32_t rank = 0; rank < buses_by_name.size(); ++rank) {
+		bus_ranks[buses_by_name[rank]] = rank;
+	}
+
+	vector<atomic<uint32_t>> visit_counts(stop_count);
+	thread_pool.ParallelFor(bus_infos_.size(), [this, &visit_counts](
+			size_t bus_id) {
+		for (const BusOrStopInfo::StopId stop_id : bus_infos_[bus_id].stops) {
+			visit_counts[stop_id].fetch_add(1, memory_order_relaxed);
+		}
+	});
+	vector<size_t> visit_offsets(stop_count + 1, 0);
+	for (size_t stop_id = 0; stop_id < stop_count; ++stop_id) {
+		visit_offsets[stop_id + 1] = visit_offsets[stop_id]
+				+ visit_counts[stop_id].exchange(0, memory_order_relaxed);
 	}
 
-	// filter buses
-	BusOrStopInfo::BusesDict buses_dict;
-	for (const auto& item : Range { stops_end, end(data) }) {
-		const auto& bus = get<BusOrStopInfo::Bus>(item);
+	vector<uint32_t> visit_bus_ranks(visit_offsets.back());
+	thread_pool.ParallelFor(bus_infos_.size(), [&](size_t bus_id) {
+		for (const BusOrStopInfo::StopId stop_id : bus_infos_[bus_id].stops) {
+			const size_t visit_idx = visit_offsets[stop_id]
+					+ visit_counts[stop_id].fetch_add(1, memory_order_relaxed);
+			visit_bus_ranks[visit_idx] = bus_ranks[bus_id];
+		}
+	});
 
-		buses_dict[bus.name] = &bus;
-		buses_[bus.name] = Bus { bus.stops.size(), ComputeUniqueItemsCount(
-				AsRange(bus.stops)), ComputeRoadRouteLength(bus.stops,
-				stops_dict), ComputeGeoRouteDistance(bus.stops, stops_dict) };
+	vector<uint32_t> bus_counts(stop_count);
+	thread_pool.ParallelFor(stop_count, [&](size_t stop_id) {
+		const auto visits_begin = begin(visit_bus_ranks) + visit_offsets[stop_id];
+		const auto visits_end = begin(visit_bus_ranks)
+				+ visit_offsets[stop_id + 1];
+		sort(visits_begin, visits_end);
+		bus_counts[stop_id] = unique(visits_begin, visits_end) - visits_begin;
+	});
+	stops_bus_offsets_ = Snapshot::FlatArray<uint32_t>(stop_count + 1, 0);
+	for (size_t stop_id = 0; stop_id < stop_count; ++stop_id) {
+		stops_bus_offsets_[stop_id + 1] = stops_bus_offsets_[stop_id]
+				+ bus_counts[stop_id];
+	}
 
-		for (const string& stop_name : bus.stops) {
-			stops_.at(stop_name).bus_names.insert(bus.name);
+	stops_bus_ids_ = Snapshot::FlatArray<BusOrStopInfo::BusId>(
+			stops_bus_offsets_[stop_count], 0);
+	BusOrStopInfo::BusId* const bus_ids = stops_bus_ids_.data();
+	thread_pool.ParallelFor(stop_count, [&](size_t stop_id) {
+		const uint32_t* bus_ranks = &visit_bus_ranks[visit_offsets[stop_id]];
+		for (uint32_t bus_idx = 0; bus_idx < bus_counts[stop_id]; ++bus_idx) {
+			bus_ids[stops_bus_offsets_[stop_id] + bus_idx] =
+					buses_by_name[bus_ranks[bus_idx]];
 		}
+	});
+}
+
+Range<const BusOrStopInfo::BusId*> TransportRegister::GetStopBusIds(
+		BusOrStopInfo::StopId stop_id) const {
+	if (stop_id + 1 >= stops_bus_offsets_.size()) {
+		return { nullptr, nullptr };
 	}
+	const BusOrStopInfo::BusId* const bus_ids = stops_bus_ids_.data();
+	return { bus_ids + stops_bus_offsets_[stop_id], bus_ids
+			+ stops_bus_offsets_[stop_id + 1] };
+}
 
-	router_ = make_unique<TransportRouter>(stops_dict, buses_dict,
-			routing_settings_json);
+TransportRegister::TransportRegister(Snapshot::Reader& reader) :
+		stop_names_(reader), bus_names_(reader), stop_infos_(
+				stop_names_.GetSize()), bus_infos_(bus_names_.GetSize()) {
+	for (BusOrStopInfo::StopId stop_id = 0; stop_id < stop_infos_.size();
+			++stop_id) {
+		auto& stop_info = stop_infos_[stop_id];
+		stop_info.id = stop_id;
+		stop_info.position = reader.Read<Earth::Point>();
+		const size_t distance_count = reader.Read<uint64_t>();
+		for (size_t distance_idx = 0; distance_idx < distance_count;
+				++distance_idx) {
+			const auto to_stop_id = reader.Read<BusOrStopInfo::StopId>();
+			stop_info.distances[to_stop_id] = reader.Read<int>();
+		}
+	}
+	stop_unit_vectors_ = MakeUnitVectors(stop_infos_);
+	stop_index_ = SpatialIndex(stop_unit_vectors_);
+	for (BusOrStopInfo::BusId bus_id = 0; bus_id < bus_infos_.size(); ++bus_id) {
+		bus_infos_[bus_id] = { bus_id,
+				reader.ReadVector<BusOrStopInfo::StopId>() };
+	}
+	stops_bus_offsets_ = reader.ReadFlatArray<uint32_t>();
+	stops_bus_ids_ = reader.ReadFlatArray<BusOrStopInfo::BusId>();
+	if (stops_bus_offsets_.size() != stop_infos_.size() + 1
+			|| stops_bus_offsets_[stop_infos_.size()] != stops_bus_ids_.size()) {
+		throw runtime_error("stop bus index does not match the stops");
+	}
+	buses_.resize(reader.Read<uint64_t>());
+	for (auto& bus : buses_) {
+		if (reader.Read<uint8_t>()) {
+			bus = Bus { .stop_count = reader.Read<uint64_t>(), .unique_stop_count =
+					reader.Read<uint64_t>(), .road_route_length = reader.Read<int32_t>(),
+					.geo_route_length = reader.Read<double>() };
+		}
+	}
+	router_ = make_unique<TransportRouter>(reader);
 }
 
-const TransportRegister::Stop* TransportRegister::GetStop(
-		const string& name) const {
-	return GetValuePointer(stops_, name);
+void TransportRegister::SaveSnapshot(const string& path) const {
+	ofstream output(path, ios::binary);
+	Snapshot::Writer writer(output);
+
+	stop_names_.Serialize(writer);
+	bus_names_.Serialize(writer);
+	for (const auto& stop_info : stop_infos_) {
+		writer.Write(stop_info.position);
+		writer.Write<uint64_t>(stop_info.distances.size());
+		for (const auto& [to_stop_id, distance] : stop_info.distances) {
+			writer.Write(to_stop_id);
+			writer.Write(distance);
+		}
+	}
+	for (const auto& bus_info : bus_infos_) {
+		writer.WriteVector(bus_info.stops);
+	}
+	writer.WriteArray(stops_bus_offsets_.data(), stops_bus_offsets_.size());
+	writer.WriteArray(stops_bus_ids_.data(), stops_bus_ids_.size());
+	// field by field, so that the padding of the structs is not saved
+	writer.Write<uint64_t>(buses_.size());
+	for (const auto& bus : buses_) {
+		writer.Write<uint8_t>(bus.has_value());
+		if (bus) {
+			writer.Write<uint64_t>(bus->stop_count);
+			writer.Write<uint64_t>(bus->unique_stop_count);
+			writer.Write<int32_t>(bus->road_route_length);
+			writer.Write(bus->geo_route_length);
+		}
+	}
+	router_->Serialize(writer);
+
+	if (!output.flush()) {
+		throw runtime_error("cannot write snapshot " + path);
+	}
+}
+
+TransportRegister TransportRegister::LoadSnapshot(const string& path) {
+	const Stopwatch stopwatch;
+	Snapshot::Reader reader(make_shared<const Snapshot::MappedFile>(path));
+	TransportRegister db(reader);
+	db.perf_stats_->RecordPhase(PerfStats::Phase::SnapshotLoad,
+			stopwatch.GetElapsed());
+	return db;
+}
+
+void TransportRegister::ApplyUpdates(const vector<Updates::Update>& updates,
+		ThreadPool& thread_pool) {
+	const Stopwatch stopwatch;
+	TransportRouter::NetworkChange change;
+	for (const auto& update : updates) {
+		visit([this, &change](const auto& update) {
+			ApplyUpdate(update, change);
+		}, update);
+	}
+	router_->Update(stop_infos_, bus_infos_, change);
+	BuildStopsBusIds(thread_pool);
+	stop_index_ = SpatialIndex(stop_unit_vectors_);
+	route_cache_->Clear();
+	rendered_stop_responses_.reset();
+	rendered_bus_responses_.reset();
+	perf_stats_->RecordPhase(PerfStats::Phase::Updates, stopwatch.GetElapsed());
+}
+
+void TransportRegister::ApplyUpdate(const Updates::AddStop& update,
+		TransportRouter::NetworkChange&) {
+	if (stop_names_.Find(update.name)) {
+		throw invalid_argument("stop already exists: " + update.name);
+	}
+	BusOrStopInfo::Stop stop = { .id = stop_names_.Intern(update.name),
+			.position = update.position };
+	for (const auto& [stop_name, distance] : update.distances) {
+		if (const auto stop_id = stop_names_.Find(stop_name)) {
+			stop.distances[*stop_id] = distance;
+		}
+	}
+	// no bus goes through the stop yet, so the router only has to add its vertices
+	stop_unit_vectors_.push_back(Earth::UnitVector::FromPoint(stop.position));
+	stop_infos_.push_back(move(stop));
+}
+
+void TransportRegister::ApplyUpdate(const Updates::AddBus& update,
+		TransportRouter::NetworkChange& change) {
+	// everything which may throw is done before the register is changed
+	BusOrStopInfo::Bus bus;
+	bus.stops.reserve(update.stops.size());
+	for (const auto& stop_name : update.stops) {
+		bus.stops.push_back(stop_names_.GetId(stop_name));
+	}
+	const Bus bus_stats = MakeBusStats(bus);
+
+	bus.id = bus_names_.Intern(update.name);
+	if (bus.id == buses_.size()) {
+		buses_.emplace_back();
+		bus_infos_.emplace_back();
+	} else if (buses_[bus.id]) {
+		change.removed_buses.insert(bus.id);
+	}
+	buses_[bus.id] = bus_stats;
+	bus_infos_[bus.id] = move(bus);
+	change.changed_buses.erase(bus.id);
+	change.added_buses.insert(bus.id);
+}
+
+void TransportRegister::ApplyUpdate(const Updates::RemoveBus& update,
+		TransportRouter::NetworkChange& change) {
+	const auto bus_id = bus_names_.Find(update.name);
+	if (!bus_id || !buses_[*bus_id]) {
+		throw out_of_range("unknown bus: " + update.name);
+	}
+	buses_[*bus_id].reset();
+	bus_infos_[*bus_id].stops.clear();
+	change.added_buses.erase(*bus_id);
+	change.changed_buses.erase(*bus_id);
+	change.removed_buses.insert(*bus_id);
+}
+
+void TransportRegister::ApplyUpdate(const Updates::SetRoadDistance& update,
+		TransportRouter::NetworkChange& change) {
+	const BusOrStopInfo::StopId stop_from = stop_names_.GetId(update.from);
+	const BusOrStopInfo::StopId stop_to = stop_names_.GetId(update.to);
+	stop_infos_[stop_from].distances[stop_to] = update.distance;
+	const bool is_used_backwards = stop_infos_[stop_to].distances.count(
+			stop_from) == 0;
+
+	// only the buses driving between the two stops are affected
+	auto update_bus = [&](BusOrStopInfo::BusId bus_id) {
+		const auto& route = bus_infos_[bus_id].stops;
+		bool is_affected = false;
+		for (size_t stop_idx = 1; stop_idx < route.size() && !is_affected;
+				++stop_idx) {
+			is_affected = (route[stop_idx - 1] == stop_from
+					&& route[stop_idx] == stop_to)
+					|| (is_used_backwards && route[stop_idx - 1] == stop_to
+							&& route[stop_idx] == stop_from);
+		}
+		if (is_affected) {
+			buses_[bus_id]->road_route_length = ComputeRoadRouteLength(route,
+					stop_infos_);
+		}
+		return is_affected;
+	};
+	// the index of the stops still has the buses as they were before the updates,
+	// the ones added since are checked separately; an added bus is not in
+	// the router yet, it gets the new distance anyway
+	for (const BusOrStopInfo::BusId bus_id : GetStopBusIds(stop_from)) {
+		if (change.added_buses.count(bus_id) == 0 && update_bus(bus_id)) {
+			change.changed_buses.insert(bus_id);
+		}
+	}
+	for (const BusOrStopInfo::BusId bus_id : change.added_buses) {
+		update_bus(bus_id);
+	}
+}
+
+TransportRegister::Bus TransportRegister::MakeBusStats(
+		const BusOrStopInfo::Bus& bus) const {
+	return Bus { bus.stops.size(), ComputeUniqueItemsCount(AsRange(bus.stops)),
+			ComputeRoadRouteLength(bus.stops, stop_infos_),
+			ComputeGeoRouteDistance(bus.stops, stop_unit_vectors_) };
+}
+
+optional<TransportRegister::Stop> TransportRegister::GetStop(
+		string_view name) const {
+	const auto stop_id = stop_names_.Find(name);
+	if (!stop_id) {
+		return nullopt;
+	}
+	return Stop { GetStopBusIds(*stop_id) };
 }
 
 const TransportRegister::Bus* TransportRegister::GetBus(
-		const string& name) const {
-	return GetValuePointer(buses_, name);
+		string_view name) const {
+	const auto bus_id = bus_names_.Find(name);
+	return bus_id && buses_[*bus_id] ? &*buses_[*bus_id] : nullptr;
 }
 
-optional<TransportRouter::RouteInfo> TransportRegister::FindRoute(
-		const string& stop_from, const string& stop_to) const {
+shared_ptr<const TransportRouter::RouteInfo> TransportRegister::FindRoute(
+		string_view stop_from, string_view stop_to) const {
+	const BusOrStopInfo::StopId stop_from_id = stop_names_.GetId(stop_from);
+	const BusOrStopInfo::StopId stop_to_id = stop_names_.GetId(stop_to);
+	const uint64_t cache_key = (static_cast<uint64_t>(stop_from_id) << 32)
+			| stop_to_id;
+	if (auto route = route_cache_->Find(cache_key)) {
+		return move(*route);
+	}
+
 	// delegate route finding to a function from router
-	return router_->FindRoute(stop_from, stop_to);
+	shared_ptr<const TransportRouter::RouteInfo> route;
+	if (auto route_info = router_->FindRoute(stop_from_id, stop_to_id)) {
+		route = make_shared<const TransportRouter::RouteInfo>(
+				move(*route_info));
+	}
+	route_cache_->Insert(cache_key, route);
+	return route;
 }
 
-int TransportRegister::ComputeRoadRouteLength(const vector<string>& stops,
-		const BusOrStopInfo::StopsDict& stops_dict) {
-	int result = 0;
-	for (size_t i = 1; i < stops.size(); ++i) {
-		result += BusOrStopInfo::ComputeStopsDistance(
-				*stops_dict.at(stops[i - 1]), *stops_dict.at(stops[i]));
+vector<SpatialIndex::Neighbour> TransportRegister::FindNearestStops(
+		Earth::Point point, size_t max_count, double max_distance) const {
+	return stop_index_.FindNearest(Earth::UnitVector::FromPoint(point),
+			max_count, max_distance);
+}
+
+vector<optional<double>> TransportRegister::ComputeRouteTimes(
+		const vector<string>& stops_from, const vector<string>& stops_to) const {
+	auto get_ids = [this](const vector<string>& stop_names) {
+		vector<BusOrStopInfo::StopId> stop_ids;
+		stop_ids.reserve(stop_names.size());
+		for (const auto& stop_name : stop_names) {
+			stop_ids.push_back(stop_names_.GetId(stop_name));
+		}
+		return stop_ids;
+	};
+	return router_->ComputeTotalTimes(get_ids(stops_from), get_ids(stops_to));
+}
+
+void TransportRegister::WarmUpRoutes(const vector<string>& stops_from,
+		ThreadPool& thread_pool) {
+	const Stopwatch stopwatch;
+	vector<BusOrStopInfo::StopId> stop_ids;
+	stop_ids.reserve(stops_from.size());
+	for (const auto& stop_name : stops_from) {
+		stop_ids.push_back(stop_names_.GetId(stop_name));
 	}
-	return result;
+	router_->WarmUp(stop_ids, thread_pool);
+	perf_stats_->RecordPhase(PerfStats::Phase::RouteWarmUp,
+			stopwatch.GetElapsed());
+}
+
+void TransportRegister::SetRenderedResponses(
+		RenderedResponses stop_responses, RenderedResponses bus_responses) {
+	rendered_stop_responses_ = move(stop_responses);
+	rendered_bus_responses_ = move(bus_responses);
+}
+
+bool TransportRegister::WriteRenderedStopResponse(string_view name,
+		int request_id, Json::Writer& writer) const {
+	if (!rendered_stop_responses_) {
+		return false;
+	}
+	const auto stop_id = stop_names_.Find(name);
+	if (!stop_id || *stop_id >= rendered_stop_responses_->GetSize()) {
+		return false;
+	}
+	rendered_stop_responses_->Write(*stop_id, request_id, writer);
+	return true;
+}
+
+bool TransportRegister::WriteRenderedBusResponse(string_view name,
+		int request_id, Json::Writer& writer) const {
+	if (!rendered_bus_responses_) {
+		return false;
+	}
+	const auto bus_id = bus_names_.Find(name);
+	if (!bus_id || *bus_id >= rendered_bus_responses_->GetSize()) {
+		return false;
+	}
+	rendered_bus_responses_->Write(*bus_id, request_id, writer);
+	return true;
+}
+
+void TransportRegister::SetRouteCacheCapacity(size_t capacity) {
+	route_cache_ = make_unique<RouteCache>(capacity);
+}
+
+void TransportRegister::WriteStats(Json::Writer& writer) const {
+	const auto bus_count = count_if(begin(buses_), end(buses_),
+			[](const optional<Bus>& bus) {
+				return bus.has_value();
+			});
+	const auto route_cache_stats = route_cache_->GetStats();
+	writer.Key("counters").BeginDict()
+		.Key("bus_count").Int(static_cast<int64_t>(bus_count))
+		.Key("graph_edge_count").Int(
+			static_cast<int64_t>(router_->GetGraphEdgeCount()))
+		.Key("graph_vertex_count").Int(
+			static_cast<int64_t>(router_->GetGraphVertexCount()))
+		.Key("route_cache_evictions").Int(
+			static_cast<int64_t>(route_cache_stats.evictions))
+		.Key("route_cache_hits").Int(static_cast<int64_t>(route_cache_stats.hits))
+		.Key("route_cache_misses").Int(
+			static_cast<int64_t>(route_cache_stats.misses))
+		.Key("router_memory_bytes").Int(
+			static_cast<int64_t>(router_->GetRouterMemoryUsage()))
+		.Key("stop_count").Int(static_cast<int64_t>(stop_infos_.size()))
+		.EndDict();
+	writer.Key("latencies");
+	perf_stats_->WriteRequestLatencies(writer);
+	writer.Key("phases");
+	perf_stats_->WritePhases(writer);
 }
 
-double TransportRegister::ComputeGeoRouteDistance(const vector<string>& stops,
-		const BusOrStopInfo::StopsDict& stops_dict) {
-	double result = 0;
-	for (size_t i = 1; i < stops.size(); ++i) {
-		result += Earth::Distance(stops_dict.at(stops[i - 1])->position,
-				stops_dict.at(stops[i])->position);
+int TransportRegister::ComputeRoadRouteLength(
+		const vector<BusOrStopInfo::StopId>& route,
+		const vector<BusOrStopInfo::Stop>& stops) {
+	int result = 0;
+	for (size_t i = 1; i < route.size(); ++i) {
+		result += BusOrStopInfo::ComputeStopsDistance(stops[route[i - 1]],
+				stops[route[i]]);
 	}
 	return result;
 }
 
+double TransportRegister::ComputeGeoRouteDistance(
+		const vector<BusOrStopInfo::StopId>& route,
+		const vector<Earth::UnitVector>& stop_unit_vectors) {
+	return Earth::ComputeRouteDistance(stop_unit_vectors.data(), route.data(),
+			route.size());
+}
+
+vector<Earth::UnitVector> TransportRegister::MakeUnitVectors(
+		const vector<BusOrStopInfo::Stop>& stops) {
+	vector<Earth::UnitVector> unit_vectors;
+	unit_vectors.reserve(stops.size());
+	for (const auto& stop : stops) {
+		unit_vectors.push_back(Earth::UnitVector::FromPoint(stop.position));
+	}
+	return unit_vectors;
+}
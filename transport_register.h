@@ -13,20 +13,28 @@
 #pragma once
 
 #include "parser.h"
+#include "distance_utils.h"
 #include "json_lib.h"
+#include "lru_cache.h"
+#include "name_table.h"
+#include "perf_stats.h"
+#include "rendered_responses.h"
+#include "snapshot.h"
+#include "spatial_index.h"
+#include "thread_pool.h"
 #include "transport_router.h"
 #include "general_utils.h"
 
+#include <memory>
 #include <optional>
-#include <set>
 #include <string>
-#include <unordered_map>
-#include <variant>
+#include <string_view>
 #include <vector>
 
 namespace Responses {
+// a view into the register, valid until it is updated
 struct Stop {
-	std::set<std::string> bus_names;
+	Range<const BusOrStopInfo::BusId*> bus_ids;  // in the order of bus names
 };
 
 struct Bus {
@@ -43,29 +51,155 @@ private:
 	using Stop = Responses::Stop;
 
 public:
-	// there are two different structures for Bus: one in the namespace
-	// BusOrStopInfo, the other in the namespace Responses
-	TransportRegister(std::vector<BusOrStopInfo::InputQuery> data,
-			const Json::Dict& routing_settings_json);
+	// finished routes by (from, to) stop ids packed into one key, nullptr for no route
+	using RouteCache = LruCache<uint64_t,
+			std::shared_ptr<const TransportRouter::RouteInfo>>;
 
-	const Stop* GetStop(const std::string& name) const;
-	const Bus* GetBus(const std::string& name) const;
+	static constexpr size_t DEFAULT_ROUTE_CACHE_CAPACITY = 4096;
 
-	std::optional<TransportRouter::RouteInfo> FindRoute(
-			const std::string& stop_from, const std::string& stop_to) const;
+	// there are two different structures for Bus: one in the namespace
+	// BusOrStopInfo, the other in the namespace Responses.
+	// The buses are processed concurrently by the threads of the pool
+	TransportRegister(BusOrStopInfo::BaseData data,
+			const Json::Dict& routing_settings_json, ThreadPool& thread_pool);
+
+	// a built register can be saved to a binary snapshot file and loaded from it
+	// without rebuilding; loading throws std::runtime_error for a broken or foreign file
+	void SaveSnapshot(const std::string& path) const;
+	static TransportRegister LoadSnapshot(const std::string& path);
+
+	// applies the changes in order and brings the router up to date once for all of them.
+	// A new stop must have a new name (std::invalid_argument otherwise), its distances
+	// to unknown stops are dropped; unknown stops of a bus or of a road distance and
+	// unknown removed buses throw std::out_of_range. Must not run concurrently with queries.
+	// The buses of the stops are indexed anew by the threads of the pool
+	void ApplyUpdates(const std::vector<Updates::Update>& updates,
+			ThreadPool& thread_pool);
+
+	std::optional<Stop> GetStop(std::string_view name) const;
+	const Bus* GetBus(std::string_view name) const;
+
+	// names are resolved from ids only when responses are written
+	std::string_view GetStopName(BusOrStopInfo::StopId stop_id) const {
+		return stop_names_.GetName(stop_id);
+	}
+
+	std::string_view GetBusName(BusOrStopInfo::BusId bus_id) const {
+		return bus_names_.GetName(bus_id);
+	}
+
+	// every name ever known, removed buses included
+	size_t GetStopCount() const {
+		return stop_names_.GetSize();
+	}
+
+	size_t GetBusCount() const {
+		return bus_names_.GetSize();
+	}
+
+	// the responses to the Stop and Bus requests for every stop and bus by id,
+	// rendered ahead; updates drop them
+	void SetRenderedResponses(RenderedResponses stop_responses,
+			RenderedResponses bus_responses);
+
+	// false if the responses have not been rendered or the name is unknown
+	bool WriteRenderedStopResponse(std::string_view name, int request_id,
+			Json::Writer& writer) const;
+	bool WriteRenderedBusResponse(std::string_view name, int request_id,
+			Json::Writer& writer) const;
+
+	// nullptr if there is no route; throws std::out_of_range for an unknown stop.
+	// The routes most recently asked for are cached, updates drop them
+	std::shared_ptr<const TransportRouter::RouteInfo> FindRoute(
+			std::string_view stop_from, std::string_view stop_to) const;
+
+	// the stops nearest to the point, nearest first (equally near ones in the order
+	// of their declaration): at most max_count of them, none farther than
+	// max_distance meters
+	std::vector<SpatialIndex::Neighbour> FindNearestStops(Earth::Point point,
+			size_t max_count, double max_distance) const;
+
+	// total times of the routes from every stop to every other, row-major
+	// (from x to), nullopt where there is no route; throws std::out_of_range
+	// for an unknown stop. The routes are neither built nor cached
+	std::vector<std::optional<double>> ComputeRouteTimes(
+			const std::vector<std::string>& stops_from,
+			const std::vector<std::string>& stops_to) const;
+
+	// computes ahead the routes from the stops, if the router computes them on
+	// demand; throws std::out_of_range for an unknown stop. Must not run
+	// concurrently with the requests
+	void WarmUpRoutes(const std::vector<std::string>& stops_from,
+			ThreadPool& thread_pool);
+
+	// 0 disables the cache; the cached routes and the counters are dropped
+	void SetRouteCacheCapacity(size_t capacity);
+
+	RouteCache::Stats GetRouteCacheStats() const {
+		return route_cache_->GetStats();
+	}
+
+	// the phases of building, loading and updating the register are recorded by it;
+	// the latencies of the requests are recorded by their callers, from any thread
+	PerfStats& GetPerfStats() const {
+		return *perf_stats_;
+	}
+
+	// the "counters" (sizes of the network, the graph and the router, the route
+	// cache hits), the request "latencies" and the "phases" as keys of a dict
+	void WriteStats(Json::Writer& writer) const;
 
 	std::string RenderMap() const;
 
 private:
-	static int ComputeRoadRouteLength(const std::vector<std::string>& stops,
-			const BusOrStopInfo::StopsDict& stops_dict);
-
-	static double ComputeGeoRouteDistance(const std::vector<std::string>& stops,
-			const BusOrStopInfo::StopsDict& stops_dict);
-
-	std::unordered_map<std::string, Stop> stops_;
-	std::unordered_map<std::string, Bus> buses_;
+	explicit TransportRegister(Snapshot::Reader& reader);
+
+	void ApplyUpdate(const Updates::AddStop& update,
+			TransportRouter::NetworkChange& change);
+	void ApplyUpdate(const Updates::AddBus& update,
+			TransportRouter::NetworkChange& change);
+	void ApplyUpdate(const Updates::RemoveBus& update,
+			TransportRouter::NetworkChange& change);
+	void ApplyUpdate(const Updates::SetRoadDistance& update,
+			TransportRouter::NetworkChange& change);
+
+	Bus MakeBusStats(const BusOrStopInfo::Bus& bus) const;
+
+	void BuildStopsBusIds(ThreadPool& thread_pool);
+
+	// empty for a stop added since the index was built
+	Range<const BusOrStopInfo::BusId*> GetStopBusIds(
+			BusOrStopInfo::StopId stop_id) const;
+
+	static int ComputeRoadRouteLength(
+			const std::vector<BusOrStopInfo::StopId>& route,
+			const std::vector<BusOrStopInfo::Stop>& stops);
+
+	static double ComputeGeoRouteDistance(
+			const std::vector<BusOrStopInfo::StopId>& route,
+			const std::vector<Earth::UnitVector>& stop_unit_vectors);
+
+	static std::vector<Earth::UnitVector> MakeUnitVectors(
+			const std::vector<BusOrStopInfo::Stop>& stops);
+
+	NameTable stop_names_;
+	NameTable bus_names_;
+	// the network as it was declared, by ids, kept for the updates
+	std::vector<BusOrStopInfo::Stop> stop_infos_;
+	std::vector<BusOrStopInfo::Bus> bus_infos_;  // a removed bus has an empty route
+	std::vector<Earth::UnitVector> stop_unit_vectors_;  // by stop id, for the geo lengths
+	SpatialIndex stop_index_;  // over stop_unit_vectors_, rebuilt after updates
+	// the buses of every stop in one array, those of stop s at
+	// [stops_bus_offsets_[s], stops_bus_offsets_[s + 1]); rebuilt after updates
+	Snapshot::FlatArray<uint32_t> stops_bus_offsets_;
+	Snapshot::FlatArray<BusOrStopInfo::BusId> stops_bus_ids_;
+	std::vector<std::optional<Bus>> buses_;  // by bus id, nullopt for a removed bus
 	std::unique_ptr<TransportRouter> router_;
+	mutable std::unique_ptr<RouteCache> route_cache_ = std::make_unique<
+			RouteCache>(DEFAULT_ROUTE_CACHE_CAPACITY);
+	std::unique_ptr<PerfStats> perf_stats_ = std::make_unique<PerfStats>();
+	std::optional<RenderedResponses> rendered_stop_responses_;
+	std::optional<RenderedResponses> rendered_bus_responses_;
 };
 
 #endif /* TRANSPORT_REGISTER_H_ */
@@ -7,24 +7,103 @@
 
 #include "transport_router.h"
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
 using namespace std;
 
-TransportRouter::TransportRouter(const BusOrStopInfo::StopsDict& stops_dict,
-		const BusOrStopInfo::BusesDict& buses_dict,
-		const Json::Dict& routing_settings_json) :
+TransportRouter::TransportRouter(const vector<BusOrStopInfo::Stop>& stops,
+		const vector<BusOrStopInfo::Bus>& buses,
+		const Json::Dict& routing_settings_json, ThreadPool& thread_pool) :
 		routing_settings_(MakeRoutingSettings(routing_settings_json)) {
 
-	// initialize the underlying graph with the count of vertices
-	const size_t vertex_count = stops_dict.size() * 2;
-	vertices_info_.resize(vertex_count);
-	graph_ = BusGraph(vertex_count);
+	// the stop vertices come first, the ride vertices of the buses follow them
+	const Stopwatch graph_fill_stopwatch;
+	GraphDraft draft;
+	for (BusOrStopInfo::StopId stop_id = 0; stop_id < stops.size(); ++stop_id) {
+		AddStop(stop_id, draft);
+	}
+	AddBuses(stops, buses, draft, thread_pool);
+	FreezeGraph(draft);
+	build_times_.graph_fill = graph_fill_stopwatch.GetElapsed();
+
+	// the router is created only now because all buses and stops have been added to the graph
+	const Stopwatch router_precompute_stopwatch;
+	router_ = MakeRouter();
+	build_times_.router_precompute = router_precompute_stopwatch.GetElapsed();
+}
 
-	FillGraphWithStops(stops_dict);
-	FillGraphWithBuses(stops_dict, buses_dict);
+TransportRouter::TransportRouter(Snapshot::Reader& reader) :
+		routing_settings_(DeserializeRoutingSettings(reader)), graph_(reader) {
+	// the router comes right after the graph it is built on
+	router_ = LoadRouter(reader);
 
-	// the router, when constructed, finds optimal routes for every vertex
-	// it can do that at this moment because all buses and stops have been added to the graph
-	router_ = std::make_unique<Router>(graph_);
+	stops_vertex_ids_ = reader.ReadVector<StopVertexIds>();
+	vertices_info_ = reader.ReadVector<VertexInfo>();
+	edges_info_.resize(reader.Read<uint64_t>());
+	for (auto& edge_info : edges_info_) {
+		edge_info = DeserializeEdgeInfo(reader);
+	}
+	buses_edge_ids_.resize(reader.Read<uint64_t>());
+	for (auto& edge_ids : buses_edge_ids_) {
+		edge_ids = reader.ReadVector<Graph::EdgeId>();
+	}
+	buses_ride_vertices_ = reader.ReadVector<RideVertices>();
+	free_ride_vertices_ = reader.ReadVector<RideVertices>();
+}
+
+void TransportRouter::Serialize(Snapshot::Writer& writer) const {
+	SerializeRoutingSettings(routing_settings_, writer);
+	graph_.Serialize(writer);
+	router_->Serialize(writer);
+
+	writer.WriteVector(stops_vertex_ids_);
+	writer.WriteVector(vertices_info_);
+	writer.Write<uint64_t>(edges_info_.size());
+	for (const auto& edge_info : edges_info_) {
+		SerializeEdgeInfo(edge_info, writer);
+	}
+	writer.Write<uint64_t>(buses_edge_ids_.size());
+	for (const auto& edge_ids : buses_edge_ids_) {
+		writer.WriteVector(edge_ids);
+	}
+	writer.WriteVector(buses_ride_vertices_);
+	writer.WriteVector(free_ride_vertices_);
+}
+
+void TransportRouter::SerializeEdgeInfo(const EdgeInfo& edge_info,
+		Snapshot::Writer& writer) {
+	writer.Write<uint8_t>(edge_info.index());
+	if (holds_alternative<BusEdgeInfo>(edge_info)) {
+		const auto& bus_edge_info = get<BusEdgeInfo>(edge_info);
+		writer.Write(bus_edge_info.bus_id);
+		writer.Write<uint64_t>(bus_edge_info.span_count);
+	} else if (holds_alternative<RideEdgeInfo>(edge_info)) {
+		const auto& ride_edge_info = get<RideEdgeInfo>(edge_info);
+		writer.Write(ride_edge_info.bus_id);
+		writer.Write(ride_edge_info.distance);
+	}
+}
+
+TransportRouter::EdgeInfo TransportRouter::DeserializeEdgeInfo(
+		Snapshot::Reader& reader) {
+	switch (reader.Read<uint8_t>()) {
+	case GetVariantIndex<EdgeInfo, BusEdgeInfo>():
+		return BusEdgeInfo { .bus_id = reader.Read<BusOrStopInfo::BusId>(),
+				.span_count = reader.Read<uint64_t>() };
+	case GetVariantIndex<EdgeInfo, WaitEdgeInfo>():
+		return WaitEdgeInfo { };
+	case GetVariantIndex<EdgeInfo, BoardEdgeInfo>():
+		return BoardEdgeInfo { };
+	case GetVariantIndex<EdgeInfo, RideEdgeInfo>():
+		return RideEdgeInfo { .bus_id = reader.Read<BusOrStopInfo::BusId>(),
+				.distance = reader.Read<int>() };
+	case GetVariantIndex<EdgeInfo, AlightEdgeInfo>():
+		return AlightEdgeInfo { };
+	default:
+		throw runtime_error("unknown edge type in snapshot");
+	}
 }
 
 TransportRouter::RoutingSettings TransportRouter::MakeRoutingSettings(
@@ -32,85 +111,482 @@ TransportRouter::RoutingSettings TransportRouter::MakeRoutingSettings(
 	return {
 		json.at("bus_wait_time").AsInt(),
 		json.at("bus_speed").AsDouble(),
+		json.count("router") > 0 ?
+				ParseRouterType(string(json.at("router").AsString())) :
+				RouterType::AllPairs,
+		Settings::ReadCount(json, "router_threads", 1),
+		json.count("bus_graph") > 0 ?
+				ParseBusGraphType(
+						string(json.at("bus_graph").AsString())) :
+				BusGraphType::StopPairs,
+		json.count("route_table_weights") > 0 ?
+				ParseTableWeightsType(
+						string(json.at("route_table_weights").AsString())) :
+				TableWeightsType::Double,
+		Settings::ReadCount(json, "route_row_cache_size",
+				DEFAULT_ROUTE_ROW_CACHE_SIZE),
 	};
 }
 
-void TransportRouter::FillGraphWithStops(
-		const BusOrStopInfo::StopsDict& stops_dict) {
-	Graph::VertexId vertex_id = 0;
+void TransportRouter::SerializeRoutingSettings(
+		const RoutingSettings& routing_settings, Snapshot::Writer& writer) {
+	writer.Write<int32_t>(routing_settings.bus_wait_time);
+	writer.Write(routing_settings.bus_speed);
+	writer.Write<uint8_t>(static_cast<uint8_t>(routing_settings.router_type));
+	writer.Write<uint8_t>(static_cast<uint8_t>(routing_settings.bus_graph_type));
+	writer.Write<uint8_t>(
+			static_cast<uint8_t>(routing_settings.table_weights_type));
+	writer.Write<uint64_t>(routing_settings.route_row_cache_size);
+}
 
-	for (const auto& stops_pair : stops_dict) {
-		const auto& stop_name = stops_pair.first;
-		auto& vertex_ids = stops_vertex_ids_[stop_name];
-		// each stop corresponds to two vertices
-		// for each stop (vertex) generate the ids of two vertices corresponding to it
-		vertex_ids.in = vertex_id++;
-		vertex_ids.out = vertex_id++;
-		vertices_info_[vertex_ids.in] = {stop_name};
-		vertices_info_[vertex_ids.out] = {stop_name};
+TransportRouter::RoutingSettings TransportRouter::DeserializeRoutingSettings(
+		Snapshot::Reader& reader) {
+	RoutingSettings routing_settings;
+	routing_settings.bus_wait_time = reader.Read<int32_t>();
+	routing_settings.bus_speed = reader.Read<double>();
+	const uint8_t router_type = reader.Read<uint8_t>();
+	const uint8_t bus_graph_type = reader.Read<uint8_t>();
+	const uint8_t table_weights_type = reader.Read<uint8_t>();
+	if (router_type > static_cast<uint8_t>(RouterType::LazyAllPairs)
+			|| bus_graph_type > static_cast<uint8_t>(BusGraphType::RouteSegments)
+			|| table_weights_type
+					> static_cast<uint8_t>(TableWeightsType::FixedPoint)) {
+		throw runtime_error("unknown routing settings in snapshot");
+	}
+	routing_settings.router_type = static_cast<RouterType>(router_type);
+	routing_settings.bus_graph_type = static_cast<BusGraphType>(bus_graph_type);
+	routing_settings.table_weights_type = static_cast<TableWeightsType>(
+			table_weights_type);
+	// the loaded routes are not precomputed again
+	routing_settings.router_thread_count = 1;
+	routing_settings.route_row_cache_size = reader.Read<uint64_t>();
+	return routing_settings;
+}
 
-		edges_info_.push_back(WaitEdgeInfo { });
+TransportRouter::RouterType TransportRouter::ParseRouterType(
+		const string& name) {
+	if (name == "all_pairs") {
+		return RouterType::AllPairs;
+	} else if (name == "dijkstra") {
+		return RouterType::Dijkstra;
+	} else if (name == "contraction_hierarchy") {
+		return RouterType::ContractionHierarchy;
+	} else if (name == "lazy_all_pairs") {
+		return RouterType::LazyAllPairs;
+	}
+	throw invalid_argument("unknown router type: " + name);
+}
 
-		// add the edge between the stop vertices with the weight equal to bus wait time
-		const Graph::EdgeId edge_id = graph_.AddEdge(
-				{ vertex_ids.out, vertex_ids.in,
-						static_cast<double>(routing_settings_.bus_wait_time) });
-		assert(edge_id == edges_info_.size() - 1);
+TransportRouter::BusGraphType TransportRouter::ParseBusGraphType(
+		const string& name) {
+	if (name == "stop_pairs") {
+		return BusGraphType::StopPairs;
+	} else if (name == "route_segments") {
+		return BusGraphType::RouteSegments;
 	}
+	throw invalid_argument("unknown bus graph type: " + name);
+}
 
-	assert(vertex_id == graph_.GetVertexCount());
+TransportRouter::TableWeightsType TransportRouter::ParseTableWeightsType(
+		const string& name) {
+	if (name == "double") {
+		return TableWeightsType::Double;
+	} else if (name == "float") {
+		return TableWeightsType::Float;
+	} else if (name == "fixed_point") {
+		return TableWeightsType::FixedPoint;
+	}
+	throw invalid_argument("unknown route table weights: " + name);
 }
 
-void TransportRouter::FillGraphWithBuses(
-		const BusOrStopInfo::StopsDict& stops_dict,
-		const BusOrStopInfo::BusesDict& buses_dict) {
+double TransportRouter::ComputeTravelTime(int distance) const {
+	return distance * 1.0 / (routing_settings_.bus_speed * 1000.0 / 60); // m / (km/h * 1000 / 60) = min
+}
 
-	for (const auto& buses_pair : buses_dict) {
+unique_ptr<TransportRouter::Router> TransportRouter::MakeRouter() const {
+	switch (routing_settings_.router_type) {
+	case RouterType::Dijkstra:
+		// nothing to precompute: each route is searched for when requested
+		return make_unique<Graph::DijkstraRouter<double>>(graph_);
+	case RouterType::ContractionHierarchy:
+		return make_unique<Graph::ContractionHierarchyRouter<double>>(graph_);
+	case RouterType::LazyAllPairs:
+		// nothing to precompute either: the routes from a source are computed at once
+		return make_unique<Graph::LazyRowRouter<double>>(graph_,
+				routing_settings_.route_row_cache_size);
+	case RouterType::AllPairs:
+	default:
+		// the router, when constructed, finds optimal routes for every vertex
+		switch (routing_settings_.table_weights_type) {
+		case TableWeightsType::Float:
+			return MakeAllPairsRouter<Graph::FloatWeights>();
+		case TableWeightsType::FixedPoint:
+			return MakeAllPairsRouter<Graph::FixedPointWeights>();
+		case TableWeightsType::Double:
+		default:
+			return MakeAllPairsRouter<Graph::ExactWeights>();
+		}
+	}
+}
 
-		const auto& bus_item = buses_pair.second;  // pointer to bus
-		const auto& bus = *bus_item;  // get the bus behind the pointer
-		const size_t stop_count = bus.stops.size(); // how many stops the bus goes through
+template<template<typename > typename Encoding>
+unique_ptr<TransportRouter::Router> TransportRouter::MakeAllPairsRouter() const {
+	return make_unique<Graph::Router<double, Encoding<double>>>(graph_,
+			routing_settings_.router_thread_count);
+}
 
-		if (stop_count <= 1) {
-			continue;
+template<template<typename > typename Encoding>
+unique_ptr<TransportRouter::Router> TransportRouter::LoadAllPairsRouter(
+		Snapshot::Reader& reader) const {
+	return make_unique<Graph::Router<double, Encoding<double>>>(graph_, reader);
+}
+
+unique_ptr<TransportRouter::Router> TransportRouter::LoadRouter(
+		Snapshot::Reader& reader) const {
+	switch (routing_settings_.router_type) {
+	case RouterType::Dijkstra:
+		return make_unique<Graph::DijkstraRouter<double>>(graph_);
+	case RouterType::ContractionHierarchy:
+		return make_unique<Graph::ContractionHierarchyRouter<double>>(graph_,
+				reader);
+	case RouterType::LazyAllPairs:
+		return make_unique<Graph::LazyRowRouter<double>>(graph_,
+				routing_settings_.route_row_cache_size);
+	case RouterType::AllPairs:
+	default:
+		switch (routing_settings_.table_weights_type) {
+		case TableWeightsType::Float:
+			return LoadAllPairsRouter<Graph::FloatWeights>(reader);
+		case TableWeightsType::FixedPoint:
+			return LoadAllPairsRouter<Graph::FixedPointWeights>(reader);
+		case TableWeightsType::Double:
+		default:
+			return LoadAllPairsRouter<Graph::ExactWeights>(reader);
 		}
-		// function to calculate distances between two consecutive stops in a bus route
-		auto compute_distance_from =
-				[&stops_dict, &bus](size_t lhs_idx) {
-					return BusOrStopInfo::ComputeStopsDistance(*stops_dict.at(bus.stops[lhs_idx]),
-							*stops_dict.at(bus.stops[lhs_idx + 1]));
-				};
-		// get the total distance for a bus
-		for (size_t start_stop_idx = 0; start_stop_idx + 1 < stop_count;
-				++start_stop_idx) {
-			const Graph::VertexId start_vertex =
-					stops_vertex_ids_[bus.stops[start_stop_idx]].in;  // start at the first in-vertex
-			int total_distance = 0;
-			// trace each possible route starting at a given stop and incrementally add edges on the way
-			// as well as edges' counts for sub-routes
-			for (size_t finish_stop_idx = start_stop_idx + 1;
-					finish_stop_idx < stop_count; ++finish_stop_idx) {
-				total_distance += compute_distance_from(finish_stop_idx - 1);
-				edges_info_.push_back(BusEdgeInfo { .bus_name = bus.name,
-						.span_count = finish_stop_idx - start_stop_idx, });
-				const Graph::EdgeId edge_id =
-						graph_.AddEdge(
-								{ start_vertex,
-										stops_vertex_ids_[bus.stops[finish_stop_idx]].out,
-										total_distance * 1.0
-												/ (routing_settings_.bus_speed
-														* 1000.0 / 60) // m / (km/h * 1000 / 60) = min
-								});
-				assert(edge_id == edges_info_.size() - 1);
-			}
+	}
+}
+
+void TransportRouter::Update(const vector<BusOrStopInfo::Stop>& stops,
+		const vector<BusOrStopInfo::Bus>& buses, const NetworkChange& change) {
+	GraphDraft draft = MakeGraphDraft();
+	const size_t old_edge_count = draft.edges.size();
+	Router::GraphChange graph_change;
+
+	for (const BusOrStopInfo::BusId bus_id : change.removed_buses) {
+		RemoveBus(bus_id, draft, graph_change);
+	}
+	for (const BusOrStopInfo::BusId bus_id : change.changed_buses) {
+		ReweighBus(stops, buses[bus_id], draft, graph_change);
+	}
+	for (BusOrStopInfo::StopId stop_id = stops_vertex_ids_.size();
+			stop_id < stops.size(); ++stop_id) {
+		AddStop(stop_id, draft);
+	}
+	for (const BusOrStopInfo::BusId bus_id : change.added_buses) {
+		AddBus(stops, buses[bus_id], draft);
+	}
+	// all the new edges are cheaper than their absence
+	for (Graph::EdgeId edge_id = old_edge_count; edge_id < draft.edges.size();
+			++edge_id) {
+		graph_change.cheaper_edges.push_back(edge_id);
+	}
+
+	FreezeGraph(draft);
+	router_->Update(graph_change);
+}
+
+void TransportRouter::WarmUp(const vector<BusOrStopInfo::StopId>& stop_ids,
+		ThreadPool& thread_pool) {
+	// routes run between the out-vertices of the stops, as for FindRoute
+	vector<Graph::VertexId> vertices;
+	vertices.reserve(stop_ids.size());
+	for (const BusOrStopInfo::StopId stop_id : stop_ids) {
+		vertices.push_back(stops_vertex_ids_[stop_id].out);
+	}
+	router_->WarmUp(vertices, thread_pool);
+}
+
+size_t TransportRouter::GetGraphVertexCount() const {
+	return graph_.GetVertexCount();
+}
+
+size_t TransportRouter::GetGraphEdgeCount() const {
+	return graph_.GetEdgeCount();
+}
+
+size_t TransportRouter::GetRouterMemoryUsage() const {
+	return router_->GetMemoryUsage();
+}
+
+TransportRouter::GraphDraft TransportRouter::MakeGraphDraft() const {
+	GraphDraft draft { .vertex_count = graph_.GetVertexCount() };
+	draft.edges.reserve(graph_.GetEdgeCount());
+	for (Graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+		draft.edges.push_back(graph_.GetEdge(edge_id));
+	}
+	return draft;
+}
+
+void TransportRouter::FreezeGraph(const GraphDraft& draft) {
+	// frozen in place: the router keeps referring to graph_
+	graph_ = FrozenBusGraph(draft.vertex_count, draft.edges);
+}
+
+void TransportRouter::AddStop(BusOrStopInfo::StopId stop_id,
+		GraphDraft& draft) {
+	assert(stop_id == stops_vertex_ids_.size());
+	// each stop corresponds to two vertices
+	const StopVertexIds vertex_ids { .in = draft.vertex_count, .out =
+			draft.vertex_count + 1 };
+	draft.vertex_count += 2;
+	stops_vertex_ids_.push_back(vertex_ids);
+	vertices_info_.push_back( { stop_id });
+	vertices_info_.push_back( { stop_id });
+
+	// add the edge between the stop vertices with the weight equal to bus wait time
+	edges_info_.push_back(WaitEdgeInfo { });
+	draft.edges.push_back( { vertex_ids.out, vertex_ids.in,
+			static_cast<double>(routing_settings_.bus_wait_time) });
+}
+
+void TransportRouter::AddBus(const vector<BusOrStopInfo::Stop>& stops,
+		const BusOrStopInfo::Bus& bus, GraphDraft& draft) {
+	const Graph::VertexId first_ride_vertex = AddRideVertices(bus, draft);
+	AppendBusEdges(bus, first_ride_vertex,
+			MakeBusEdges(stops, bus, first_ride_vertex), draft);
+}
+
+void TransportRouter::AddBuses(const vector<BusOrStopInfo::Stop>& stops,
+		const vector<BusOrStopInfo::Bus>& buses, GraphDraft& draft,
+		ThreadPool& thread_pool) {
+	vector<Graph::VertexId> first_ride_vertices;
+	first_ride_vertices.reserve(buses.size());
+	for (const auto& bus : buses) {
+		first_ride_vertices.push_back(AddRideVertices(bus, draft));
+	}
+
+	vector<BusEdges> buses_edges(buses.size());
+	thread_pool.ParallelFor(buses.size(), [&](size_t bus_idx) {
+		buses_edges[bus_idx] = MakeBusEdges(stops, buses[bus_idx],
+				first_ride_vertices[bus_idx]);
+	});
+
+	size_t edge_count = draft.edges.size();
+	for (const auto& bus_edges : buses_edges) {
+		edge_count += bus_edges.size();
+	}
+	draft.edges.reserve(edge_count);
+	edges_info_.reserve(edge_count);
+	for (size_t bus_idx = 0; bus_idx < buses.size(); ++bus_idx) {
+		AppendBusEdges(buses[bus_idx], first_ride_vertices[bus_idx],
+				move(buses_edges[bus_idx]), draft);
+	}
+}
+
+Graph::VertexId TransportRouter::AddRideVertices(
+		const BusOrStopInfo::Bus& bus, GraphDraft& draft) {
+	const size_t ride_vertex_count = GetRideVertexCount(bus);
+	if (ride_vertex_count == 0) {
+		return draft.vertex_count;
+	}
+	const auto free_it = find_if(begin(free_ride_vertices_),
+			end(free_ride_vertices_), [ride_vertex_count](const RideVertices& free) {
+				return free.count == ride_vertex_count;
+			});
+	if (free_it != end(free_ride_vertices_)) {
+		const Graph::VertexId first_ride_vertex = free_it->first;
+		free_ride_vertices_.erase(free_it);
+		for (size_t stop_idx = 0; stop_idx < ride_vertex_count; ++stop_idx) {
+			vertices_info_[first_ride_vertex + stop_idx] = { bus.stops[stop_idx] };
+		}
+		return first_ride_vertex;
+	}
+
+	const Graph::VertexId first_ride_vertex = draft.vertex_count;
+	for (size_t stop_idx = 0; stop_idx < ride_vertex_count; ++stop_idx) {
+		vertices_info_.push_back( { bus.stops[stop_idx] });
+	}
+	draft.vertex_count += ride_vertex_count;
+	return first_ride_vertex;
+}
+
+void TransportRouter::AppendBusEdges(const BusOrStopInfo::Bus& bus,
+		Graph::VertexId first_ride_vertex, BusEdges bus_edges,
+		GraphDraft& draft) {
+	if (bus.id >= buses_edge_ids_.size()) {
+		buses_edge_ids_.resize(bus.id + 1);
+		buses_ride_vertices_.resize(bus.id + 1, { 0, 0 });
+	}
+	buses_ride_vertices_[bus.id] = { first_ride_vertex, GetRideVertexCount(bus) };
+
+	auto& edge_ids = buses_edge_ids_[bus.id];
+	edge_ids.clear();
+	edge_ids.reserve(bus_edges.size());
+	for (auto& [edge, edge_info] : bus_edges) {
+		edge_ids.push_back(draft.edges.size());
+		draft.edges.push_back(edge);
+		edges_info_.push_back(move(edge_info));
+	}
+}
+
+void TransportRouter::RemoveBus(BusOrStopInfo::BusId bus_id, GraphDraft& draft,
+		Router::GraphChange& graph_change) {
+	if (bus_id >= buses_edge_ids_.size()) {
+		return;
+	}
+	// the ride vertices of the bus are left without edges, free to be taken
+	for (const Graph::EdgeId edge_id : buses_edge_ids_[bus_id]) {
+		draft.edges[edge_id].weight = numeric_limits<double>::infinity();
+		graph_change.dearer_edges.push_back(edge_id);
+	}
+	buses_edge_ids_[bus_id].clear();
+	if (buses_ride_vertices_[bus_id].count > 0) {
+		free_ride_vertices_.push_back(buses_ride_vertices_[bus_id]);
+		buses_ride_vertices_[bus_id] = { 0, 0 };
+	}
+}
+
+void TransportRouter::ReweighBus(const vector<BusOrStopInfo::Stop>& stops,
+		const BusOrStopInfo::Bus& bus, GraphDraft& draft,
+		Router::GraphChange& graph_change) {
+	// the route is the same, so the edges come out in the same order as before
+	const auto& edge_ids = buses_edge_ids_[bus.id];
+	auto bus_edges = MakeBusEdges(stops, bus, buses_ride_vertices_[bus.id].first);
+	assert(bus_edges.size() == edge_ids.size());
+	for (size_t edge_idx = 0; edge_idx < edge_ids.size(); ++edge_idx) {
+		const Graph::EdgeId edge_id = edge_ids[edge_idx];
+		auto& [new_edge, new_edge_info] = bus_edges[edge_idx];
+		auto& edge = draft.edges[edge_id];
+		if (new_edge.weight < edge.weight) {
+			graph_change.cheaper_edges.push_back(edge_id);
+		} else if (new_edge.weight > edge.weight) {
+			graph_change.dearer_edges.push_back(edge_id);
+		}
+		edge.weight = new_edge.weight;
+		edges_info_[edge_id] = move(new_edge_info);
+	}
+}
+
+size_t TransportRouter::GetRideVertexCount(
+		const BusOrStopInfo::Bus& bus) const {
+	if (routing_settings_.bus_graph_type != BusGraphType::RouteSegments
+			|| bus.stops.size() <= 1) {
+		return 0;
+	}
+	return bus.stops.size();
+}
+
+TransportRouter::BusEdges TransportRouter::MakeBusEdges(
+		const vector<BusOrStopInfo::Stop>& stops, const BusOrStopInfo::Bus& bus,
+		Graph::VertexId first_ride_vertex) const {
+	if (routing_settings_.bus_graph_type == BusGraphType::RouteSegments) {
+		return MakeRouteSegmentsEdges(stops, bus, first_ride_vertex);
+	}
+	return MakeStopPairsEdges(stops, bus);
+}
+
+TransportRouter::BusEdges TransportRouter::MakeStopPairsEdges(
+		const vector<BusOrStopInfo::Stop>& stops,
+		const BusOrStopInfo::Bus& bus) const {
+	BusEdges edges;
+	const size_t stop_count = bus.stops.size(); // how many stops the bus goes through
+	if (stop_count <= 1) {
+		return edges;
+	}
+	edges.reserve(stop_count * (stop_count - 1) / 2);
+
+	// function to calculate distances between two consecutive stops in a bus route
+	auto compute_distance_from =
+			[&stops, &bus](size_t lhs_idx) {
+				return BusOrStopInfo::ComputeStopsDistance(stops[bus.stops[lhs_idx]],
+						stops[bus.stops[lhs_idx + 1]]);
+			};
+	// get the total distance for a bus
+	for (size_t start_stop_idx = 0; start_stop_idx + 1 < stop_count;
+			++start_stop_idx) {
+		const Graph::VertexId start_vertex =
+				stops_vertex_ids_[bus.stops[start_stop_idx]].in;  // start at the first in-vertex
+		int total_distance = 0;
+		// trace each possible route starting at a given stop and incrementally add edges on the way
+		// as well as edges' counts for sub-routes
+		for (size_t finish_stop_idx = start_stop_idx + 1;
+				finish_stop_idx < stop_count; ++finish_stop_idx) {
+			total_distance += compute_distance_from(finish_stop_idx - 1);
+			edges.emplace_back(
+					Graph::Edge<double> { start_vertex,
+							stops_vertex_ids_[bus.stops[finish_stop_idx]].out,
+							ComputeTravelTime(total_distance) },
+					BusEdgeInfo { .bus_id = bus.id, .span_count = finish_stop_idx
+							- start_stop_idx, });
+		}
+	}
+	return edges;
+}
+
+TransportRouter::BusEdges TransportRouter::MakeRouteSegmentsEdges(
+		const vector<BusOrStopInfo::Stop>& stops, const BusOrStopInfo::Bus& bus,
+		Graph::VertexId first_ride_vertex) const {
+	BusEdges edges;
+	const size_t stop_count = bus.stops.size();
+	if (stop_count <= 1) {
+		return edges;
+	}
+	edges.reserve(stop_count * 3 - 3);
+
+	// one ride vertex per stop of the route: a passenger boards from the stop's
+	// in-vertex without extra cost (the wait is already paid), rides along the
+	// segments and alights to the out-vertex of a later stop
+	for (size_t stop_idx = 0; stop_idx < stop_count; ++stop_idx) {
+		const Graph::VertexId ride_vertex = first_ride_vertex + stop_idx;
+		const auto& vertex_ids = stops_vertex_ids_[bus.stops[stop_idx]];
+		if (stop_idx + 1 < stop_count) {
+			edges.emplace_back(Graph::Edge<double> { vertex_ids.in, ride_vertex,
+					0.0 }, BoardEdgeInfo { });
+			const int distance = BusOrStopInfo::ComputeStopsDistance(
+					stops[bus.stops[stop_idx]], stops[bus.stops[stop_idx + 1]]);
+			edges.emplace_back(Graph::Edge<double> { ride_vertex, ride_vertex + 1,
+					ComputeTravelTime(distance) }, RideEdgeInfo { .bus_id = bus.id,
+					.distance = distance });
+		}
+		if (stop_idx > 0) {
+			edges.emplace_back(Graph::Edge<double> { ride_vertex, vertex_ids.out,
+					0.0 }, AlightEdgeInfo { });
+		}
+	}
+	return edges;
+}
+
+vector<optional<double>> TransportRouter::ComputeTotalTimes(
+		const vector<BusOrStopInfo::StopId>& stops_from,
+		const vector<BusOrStopInfo::StopId>& stops_to) const {
+	// routes run between the out-vertices of the stops, as for FindRoute
+	auto get_vertices = [this](const vector<BusOrStopInfo::StopId>& stop_ids) {
+		vector<Graph::VertexId> vertices;
+		vertices.reserve(stop_ids.size());
+		for (const BusOrStopInfo::StopId stop_id : stop_ids) {
+			vertices.push_back(stops_vertex_ids_[stop_id].out);
+		}
+		return vertices;
+	};
+	const vector<double> weights = router_->ComputeWeightMatrix(
+			get_vertices(stops_from), get_vertices(stops_to));
+
+	vector<optional<double>> total_times;
+	total_times.reserve(weights.size());
+	for (const double weight : weights) {
+		if (weight == numeric_limits<double>::infinity()) {
+			total_times.push_back(nullopt);
+		} else {
+			total_times.push_back(weight);
 		}
 	}
+	return total_times;
 }
 
 optional<TransportRouter::RouteInfo> TransportRouter::FindRoute(
-		const string& stop_from, const string& stop_to) const {
-	const Graph::VertexId vertex_from = stops_vertex_ids_.at(stop_from).out;
-	const Graph::VertexId vertex_to = stops_vertex_ids_.at(stop_to).out;
+		BusOrStopInfo::StopId stop_from, BusOrStopInfo::StopId stop_to) const {
+	const Graph::VertexId vertex_from = stops_vertex_ids_[stop_from].out;
+	const Graph::VertexId vertex_to = stops_vertex_ids_[stop_to].out;
 	// when this method is called, all optimal routes have already been calculated
 	const auto route = router_->BuildRoute(vertex_from, vertex_to);
 	if (!route) {
@@ -120,21 +596,37 @@ optional<TransportRouter::RouteInfo> TransportRouter::FindRoute(
 	// (on travel time, wait time, stops etc.)
 	RouteInfo route_info = { .total_time = route->weight };
 	route_info.items.reserve(route->edge_count);
+	int ride_distance = 0;  // of the current bus item in the route segments graph
 	for (size_t edge_idx = 0; edge_idx < route->edge_count; ++edge_idx) {
 		const Graph::EdgeId edge_id = router_->GetRouteEdge(route->id,
 				edge_idx);
-		const auto& edge = graph_.GetEdge(edge_id);
+		const auto edge = graph_.GetEdge(edge_id);
 		const auto& edge_info = edges_info_[edge_id];
 		if (holds_alternative<BusEdgeInfo>(edge_info)) {
 			const BusEdgeInfo& bus_edge_info = get<BusEdgeInfo>(edge_info);
-			route_info.items.push_back(RouteInfo::BusItem { .bus_name =
-					bus_edge_info.bus_name, .time = edge.weight, .span_count =
+			route_info.items.push_back(RouteInfo::BusItem { .bus_id =
+					bus_edge_info.bus_id, .time = edge.weight, .span_count =
 					bus_edge_info.span_count, });
+		} else if (holds_alternative<BoardEdgeInfo>(edge_info)) {
+			// the bus item is completed by the following ride and alight edges
+			route_info.items.push_back(RouteInfo::BusItem { .bus_id = 0,
+					.time = 0.0, .span_count = 0, });
+			ride_distance = 0;
+		} else if (holds_alternative<RideEdgeInfo>(edge_info)) {
+			const RideEdgeInfo& ride_edge_info = get<RideEdgeInfo>(edge_info);
+			auto& bus_item = get<RouteInfo::BusItem>(route_info.items.back());
+			bus_item.bus_id = ride_edge_info.bus_id;
+			++bus_item.span_count;
+			ride_distance += ride_edge_info.distance;
+		} else if (holds_alternative<AlightEdgeInfo>(edge_info)) {
+			// the time of the whole ride is computed as for the stop pairs graph
+			get<RouteInfo::BusItem>(route_info.items.back()).time =
+					ComputeTravelTime(ride_distance);
 		} else {
 			const Graph::VertexId vertex_id = edge.from;
 			route_info.items.push_back(
-					RouteInfo::WaitItem { .stop_name =
-							vertices_info_[vertex_id].stop_name, .time =
+					RouteInfo::WaitItem { .stop_id =
+							vertices_info_[vertex_id].stop_id, .time =
 							edge.weight, });
 		}
 	}
@@ -11,35 +11,50 @@
 #pragma once
 
 #include "parser.h"
+#include "contraction_hierarchy_router.h"
+#include "csr_graph.h"
+#include "dijkstra_router.h"
 #include "graph.h"
 #include "json_lib.h"
+#include "lazy_row_router.h"
+#include "perf_stats.h"
 #include "router.h"
+#include "router_base.h"
+#include "snapshot.h"
+#include "thread_pool.h"
 
+#include <chrono>
 #include <memory>
-#include <unordered_map>
+#include <set>
+#include <utility>
 #include <vector>
 
 class TransportRouter {
 private:
-	using BusGraph = Graph::DirectedWeightedGraph<double>;
-	using Router = Graph::Router<double>;
+	using FrozenBusGraph = Graph::CsrGraph<double>;
+	using Router = Graph::RouterBase<double>;
 
 public:
-	TransportRouter(const BusOrStopInfo::StopsDict& stops_dict,
-			const BusOrStopInfo::BusesDict& buses_dict,
-			const Json::Dict& routing_settings_json);
+	// the stops and buses are indexed by their ids; the edges of the buses
+	// are made by the threads of the pool
+	TransportRouter(const std::vector<BusOrStopInfo::Stop>& stops,
+			const std::vector<BusOrStopInfo::Bus>& buses,
+			const Json::Dict& routing_settings_json, ThreadPool& thread_pool);
+	explicit TransportRouter(Snapshot::Reader& reader);
+
+	void Serialize(Snapshot::Writer& writer) const;
 
 	struct RouteInfo {
 		double total_time;
 
 		struct BusItem {
-			std::string bus_name;
+			BusOrStopInfo::BusId bus_id;
 			double time;
 			size_t span_count;
 		};
 
 		struct WaitItem {
-			std::string stop_name;
+			BusOrStopInfo::StopId stop_id;
 			double time;
 		};
 
@@ -47,21 +62,114 @@ public:
 		std::vector<Item> items;
 	};
 
-	std::optional<RouteInfo> FindRoute(const std::string& stop_from,
-			const std::string& stop_to) const;
+	std::optional<RouteInfo> FindRoute(BusOrStopInfo::StopId stop_from,
+			BusOrStopInfo::StopId stop_to) const;
+
+	// total times of the routes from every stop to every other, row-major
+	// (from x to), nullopt where there is no route; computed in one batch
+	std::vector<std::optional<double>> ComputeTotalTimes(
+			const std::vector<BusOrStopInfo::StopId>& stops_from,
+			const std::vector<BusOrStopInfo::StopId>& stops_to) const;
+
+	// buses touched by a batch of updates; the stops are only ever added,
+	// with the ids following the known ones
+	struct NetworkChange {
+		std::set<BusOrStopInfo::BusId> removed_buses;  // including the replaced ones
+		std::set<BusOrStopInfo::BusId> changed_buses;  // whose road distances have changed
+		std::set<BusOrStopInfo::BusId> added_buses;  // including the replacements
+	};
+
+	// changes the graph in place and lets the router catch up with it instead of
+	// building it anew; the stops and buses are the whole network after the change.
+	// The edges of removed buses are kept with an infinite weight, so the edge
+	// count only grows; the ride vertices of a removed bus are taken by a later
+	// bus with as many, so the vertex count (which the all-pairs tables are
+	// quadratic in) grows only by the routes of new lengths.
+	// Must not run concurrently with FindRoute
+	void Update(const std::vector<BusOrStopInfo::Stop>& stops,
+			const std::vector<BusOrStopInfo::Bus>& buses,
+			const NetworkChange& change);
+
+	// computes ahead the routes from the stops, for the routers which compute
+	// them on demand; must not run concurrently with FindRoute
+	void WarmUp(const std::vector<BusOrStopInfo::StopId>& stop_ids,
+			ThreadPool& thread_pool);
+
+	// how long the construction took, zero for a router loaded from a snapshot
+	struct BuildTimes {
+		std::chrono::nanoseconds graph_fill { 0 };
+		std::chrono::nanoseconds router_precompute { 0 };
+	};
+
+	const BuildTimes& GetBuildTimes() const {
+		return build_times_;
+	}
+
+	// sizes for the performance counters; removed edges are still counted
+	size_t GetGraphVertexCount() const;
+	size_t GetGraphEdgeCount() const;
+	size_t GetRouterMemoryUsage() const;
 
 private:
+	// how optimal routes are looked for
+	enum class RouterType {
+		AllPairs,  // all routes are precomputed at construction
+		Dijkstra,  // each route is searched on demand
+		ContractionHierarchy,  // a hierarchy of shortcuts is precomputed, routes are searched in it
+		LazyAllPairs,  // the routes from a source are computed on its first query and cached
+	};
+
+	// how the all-pairs router stores the route weights, see router.h
+	enum class TableWeightsType {
+		Double,  // exact, 12 bytes per pair of vertices with the last edge
+		Float,  // 8 bytes per pair
+		FixedPoint,  // 1/1024 of a minute in 32 bits, 8 bytes per pair
+	};
+
+	// how buses are represented in the graph
+	enum class BusGraphType {
+		StopPairs,  // an edge from every stop to every later stop of a bus, O(L^2) per bus
+		RouteSegments,  // a chain of ride vertices per bus, O(L) per bus
+	};
+
+	static constexpr size_t DEFAULT_ROUTE_ROW_CACHE_SIZE = 1024;
+
 	struct RoutingSettings {
 		int bus_wait_time;  // in minutes
 		double bus_speed;  // km/h
+		RouterType router_type;
+		size_t router_thread_count;  // for precomputing all routes, 0 for all hardware threads
+		BusGraphType bus_graph_type;
+		TableWeightsType table_weights_type;
+		size_t route_row_cache_size;  // sources whose routes the lazy router keeps
 	};
 
 	static RoutingSettings MakeRoutingSettings(const Json::Dict& json);
 
-	void FillGraphWithStops(const BusOrStopInfo::StopsDict& stops_dict);
+	// field by field, without the padding of the struct; the thread count belongs
+	// to the machine which precomputed the routes and is not saved
+	static void SerializeRoutingSettings(const RoutingSettings& routing_settings,
+			Snapshot::Writer& writer);
+
+	static RoutingSettings DeserializeRoutingSettings(Snapshot::Reader& reader);
+
+	static RouterType ParseRouterType(const std::string& name);
+
+	static BusGraphType ParseBusGraphType(const std::string& name);
 
-	void FillGraphWithBuses(const BusOrStopInfo::StopsDict& stops_dict,
-			const BusOrStopInfo::BusesDict& buses_dict);
+	static TableWeightsType ParseTableWeightsType(const std::string& name);
+
+	template<template<typename > typename Encoding>
+	std::unique_ptr<Router> MakeAllPairsRouter() const;
+
+	template<template<typename > typename Encoding>
+	std::unique_ptr<Router> LoadAllPairsRouter(Snapshot::Reader& reader) const;
+
+	double ComputeTravelTime(int distance) const;
+
+	std::unique_ptr<Router> MakeRouter() const;
+
+	std::unique_ptr<Router> LoadRouter(Snapshot::Reader& reader) const;
 
 	struct StopVertexIds {
 		Graph::VertexId in;
@@ -69,25 +177,112 @@ private:
 	};
 
 	struct VertexInfo {
-		std::string stop_name;
+		BusOrStopInfo::StopId stop_id;
 	};
 
 	struct BusEdgeInfo {
-		std::string bus_name;
+		BusOrStopInfo::BusId bus_id;
 		size_t span_count;
 	};
 
 	struct WaitEdgeInfo {
 	};
 
-	using EdgeInfo = std::variant<BusEdgeInfo, WaitEdgeInfo>;
+	// edges of the route segments graph: a passenger boards a bus at a stop,
+	// rides it along some segments of its route and alights at a later stop
+	struct BoardEdgeInfo {
+	};
+
+	struct RideEdgeInfo {
+		BusOrStopInfo::BusId bus_id;
+		int distance;  // road distance of the segment
+	};
+
+	struct AlightEdgeInfo {
+	};
+
+	using EdgeInfo = std::variant<BusEdgeInfo, WaitEdgeInfo, BoardEdgeInfo,
+			RideEdgeInfo, AlightEdgeInfo>;
+
+	static void SerializeEdgeInfo(const EdgeInfo& edge_info,
+			Snapshot::Writer& writer);
+
+	static EdgeInfo DeserializeEdgeInfo(Snapshot::Reader& reader);
+
+	// the graph while it is built or updated: vertices and edges are only appended,
+	// so edge ids stay stable, and a removed edge gets an infinite weight
+	struct GraphDraft {
+		size_t vertex_count = 0;
+		std::vector<Graph::Edge<double>> edges;
+	};
+
+	GraphDraft MakeGraphDraft() const;
+
+	void FreezeGraph(const GraphDraft& draft);
+
+	void AddStop(BusOrStopInfo::StopId stop_id, GraphDraft& draft);
+
+	using BusEdges = std::vector<std::pair<Graph::Edge<double>, EdgeInfo>>;
+
+	void AddBus(const std::vector<BusOrStopInfo::Stop>& stops,
+			const BusOrStopInfo::Bus& bus, GraphDraft& draft);
+
+	// the edges of every bus are made concurrently into buffers of their own and
+	// appended in the order of the buses, so edge ids do not depend on the threads
+	void AddBuses(const std::vector<BusOrStopInfo::Stop>& stops,
+			const std::vector<BusOrStopInfo::Bus>& buses, GraphDraft& draft,
+			ThreadPool& thread_pool);
+
+	// returns the first of the ride vertices of the bus; the vertices left by
+	// a removed bus are taken if there were as many of them
+	Graph::VertexId AddRideVertices(const BusOrStopInfo::Bus& bus,
+			GraphDraft& draft);
+
+	void AppendBusEdges(const BusOrStopInfo::Bus& bus,
+			Graph::VertexId first_ride_vertex, BusEdges bus_edges,
+			GraphDraft& draft);
+
+	void RemoveBus(BusOrStopInfo::BusId bus_id, GraphDraft& draft,
+			Router::GraphChange& graph_change);
+
+	void ReweighBus(const std::vector<BusOrStopInfo::Stop>& stops,
+			const BusOrStopInfo::Bus& bus, GraphDraft& draft,
+			Router::GraphChange& graph_change);
+
+	// ride vertices of a bus in the route segments graph: one per stop of its route
+	size_t GetRideVertexCount(const BusOrStopInfo::Bus& bus) const;
+
+	// the edges of a bus in the order of their creation, the same for a given
+	// route and distances whenever they are made
+	BusEdges MakeBusEdges(const std::vector<BusOrStopInfo::Stop>& stops,
+			const BusOrStopInfo::Bus& bus, Graph::VertexId first_ride_vertex) const;
+
+	BusEdges MakeStopPairsEdges(const std::vector<BusOrStopInfo::Stop>& stops,
+			const BusOrStopInfo::Bus& bus) const;
+
+	BusEdges MakeRouteSegmentsEdges(
+			const std::vector<BusOrStopInfo::Stop>& stops,
+			const BusOrStopInfo::Bus& bus, Graph::VertexId first_ride_vertex) const;
 
 	RoutingSettings routing_settings_;
-	BusGraph graph_;
+	FrozenBusGraph graph_;  // the graph is frozen once all buses and stops have been added
 	std::unique_ptr<Router> router_;
-	std::unordered_map<std::string, StopVertexIds> stops_vertex_ids_;  // map from stop name to its corresponding in- and out-vertices
+	std::vector<StopVertexIds> stops_vertex_ids_;  // in- and out-vertices of every stop by its id
 	std::vector<VertexInfo> vertices_info_;
 	std::vector<EdgeInfo> edges_info_;
+	// consecutive ride vertices of a bus in the route segments graph
+	struct RideVertices {
+		Graph::VertexId first;
+		size_t count;
+	};
+
+	// edges of every bus by its id, to be reweighed or removed on updates, and
+	// its ride vertices
+	std::vector<std::vector<Graph::EdgeId>> buses_edge_ids_;
+	std::vector<RideVertices> buses_ride_vertices_;
+	// the ride vertices of removed buses, without edges, to be taken by new buses
+	std::vector<RideVertices> free_ride_vertices_;
+	BuildTimes build_times_;
 };
 
 #endif /* TRANSPORT_ROUTER_H_ */